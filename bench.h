@@ -0,0 +1,72 @@
+#pragma once
+
+// Headless benchmark mode shared by the simulations. With --bench N a program
+// skips GLFW entirely, runs N steps at a fixed dt from a seeded starting state
+// and prints one JSON object per run to stdout, e.g.
+//
+//   ./particles2 --bench 2000 --count 5000 --seed 7 >> results.jsonl
+
+#include <sys/resource.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+struct BenchOptions {
+    bool enabled = false;
+    int steps = 1000;
+    float dt = 1.0f / 60.0f;
+    unsigned int seed = 1;
+    int count = 1000; // initial particles, or live-cell percentage for Life
+};
+
+// Consumes argv[i] (and its value) if it is a benchmark option.
+inline bool parseBenchOption(int& i, int argc, char** argv, BenchOptions& options) {
+    if (i + 1 >= argc) return false;
+    if (std::strcmp(argv[i], "--bench") == 0) {
+        options.enabled = true;
+        options.steps = std::atoi(argv[++i]);
+    } else if (std::strcmp(argv[i], "--dt") == 0) {
+        options.dt = static_cast<float>(std::atof(argv[++i]));
+    } else if (std::strcmp(argv[i], "--seed") == 0) {
+        options.seed = static_cast<unsigned int>(std::strtoul(argv[++i], nullptr, 10));
+    } else if (std::strcmp(argv[i], "--count") == 0) {
+        options.count = std::atoi(argv[++i]);
+    } else {
+        return false;
+    }
+    return true;
+}
+
+inline long peakMemoryKb() {
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return usage.ru_maxrss / 1024; // bytes on macOS
+#else
+    return usage.ru_maxrss;
+#endif
+}
+
+using BenchClock = std::chrono::steady_clock;
+
+// Counters are totals over the run; they are reported per step.
+inline void printBenchReport(
+    const char* program,
+    const BenchOptions& options,
+    BenchClock::duration elapsed,
+    const std::vector<std::pair<const char*, double>>& counters
+) {
+    double seconds = std::chrono::duration<double>(elapsed).count();
+    int steps = options.steps > 0 ? options.steps : 1;
+    std::printf("{\"program\":\"%s\",\"steps\":%d,\"dt\":%g,\"seed\":%u,\"count\":%d",
+                program, options.steps, options.dt, options.seed, options.count);
+    std::printf(",\"ns_per_step\":%.1f,\"steps_per_sec\":%.2f", seconds * 1e9 / steps, steps / seconds);
+    for (const auto& counter : counters) {
+        std::printf(",\"%s_per_step\":%.2f", counter.first, counter.second / steps);
+    }
+    std::printf(",\"peak_memory_kb\":%ld}\n", peakMemoryKb());
+    std::fflush(stdout);
+}
@@ -0,0 +1,141 @@
+#pragma once
+
+// Symmetric sparse matrices in 2x2 block CSR form, and a block-Jacobi
+// preconditioned conjugate gradient solver for them. There is one block row per
+// simulation node, so the x/y coupling of a spring stays inside one block, and
+// vectors interleave x and y per node.
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+struct BlockCsr {
+    int rows = 0;
+    std::vector<int> rowStart;  // rows + 1 offsets into column and blocks
+    std::vector<int> column;    // sorted within each row
+    std::vector<float> blocks;  // 4 floats per block, row-major
+};
+
+// Index of block (row, col), or -1 if it is not in the sparsity pattern.
+inline int findBlock(const BlockCsr& matrix, int row, int col) {
+    auto first = matrix.column.begin() + matrix.rowStart[row];
+    auto last = matrix.column.begin() + matrix.rowStart[row + 1];
+    auto it = std::lower_bound(first, last, col);
+    return it != last && *it == col ? static_cast<int>(it - matrix.column.begin()) : -1;
+}
+
+inline void multiply(const BlockCsr& matrix, const float* x, float* y) {
+#if defined(__SSE2__)
+    // One block times (vx, vy, vx, vy) per multiply; the halves are summed at the end.
+    for (int row = 0; row < matrix.rows; ++row) {
+        __m128 sum = _mm_setzero_ps();
+        for (int b = matrix.rowStart[row]; b < matrix.rowStart[row + 1]; ++b) {
+            double pair;
+            std::memcpy(&pair, x + 2 * matrix.column[b], sizeof(pair));
+            __m128 v = _mm_castpd_ps(_mm_set1_pd(pair));
+            sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(&matrix.blocks[4 * b]), v));
+        }
+        float lanes[4];
+        _mm_storeu_ps(lanes, sum);
+        y[2 * row] = lanes[0] + lanes[1];
+        y[2 * row + 1] = lanes[2] + lanes[3];
+    }
+#else
+    for (int row = 0; row < matrix.rows; ++row) {
+        float sumX = 0.0f, sumY = 0.0f;
+        for (int b = matrix.rowStart[row]; b < matrix.rowStart[row + 1]; ++b) {
+            const float* block = &matrix.blocks[4 * b];
+            float vx = x[2 * matrix.column[b]];
+            float vy = x[2 * matrix.column[b] + 1];
+            sumX += block[0] * vx + block[1] * vy;
+            sumY += block[2] * vx + block[3] * vy;
+        }
+        y[2 * row] = sumX;
+        y[2 * row + 1] = sumY;
+    }
+#endif
+}
+
+// Four partial sums so the additions do not form one serial dependency chain.
+inline double dot(const std::vector<float>& a, const std::vector<float>& b) {
+    double sum[4] = {};
+    size_t i = 0;
+    for (; i + 4 <= a.size(); i += 4) {
+        for (int lane = 0; lane < 4; ++lane) sum[lane] += static_cast<double>(a[i + lane]) * b[i + lane];
+    }
+    for (; i < a.size(); ++i) sum[0] += static_cast<double>(a[i]) * b[i];
+    return (sum[0] + sum[1]) + (sum[2] + sum[3]);
+}
+
+// Scratch vectors kept between solves so a step does not allocate.
+struct PcgWorkspace {
+    std::vector<float> r, z, p, q;
+    std::vector<float> inverseDiagonal; // inverted diagonal blocks
+};
+
+// Solves matrix * x = b for symmetric positive definite matrix, starting from
+// the x passed in (warm start). Stops once |r| <= tolerance * |b|. Returns the
+// number of iterations run.
+inline int solvePcg(const BlockCsr& matrix, const std::vector<float>& b, std::vector<float>& x,
+                    float tolerance, int maxIterations, PcgWorkspace& work) {
+    const size_t n = b.size();
+    work.r.resize(n);
+    work.z.resize(n);
+    work.p.resize(n);
+    work.q.resize(n);
+    work.inverseDiagonal.resize(4 * matrix.rows);
+
+    for (int row = 0; row < matrix.rows; ++row) {
+        const float* block = &matrix.blocks[4 * findBlock(matrix, row, row)];
+        float det = block[0] * block[3] - block[1] * block[2];
+        float inv = std::fabs(det) > 1e-20f ? 1.0f / det : 0.0f;
+        float* out = &work.inverseDiagonal[4 * row];
+        out[0] = block[3] * inv;
+        out[1] = -block[1] * inv;
+        out[2] = -block[2] * inv;
+        out[3] = block[0] * inv;
+    }
+    auto precondition = [&](const std::vector<float>& in, std::vector<float>& out) {
+        for (int row = 0; row < matrix.rows; ++row) {
+            const float* m = &work.inverseDiagonal[4 * row];
+            out[2 * row] = m[0] * in[2 * row] + m[1] * in[2 * row + 1];
+            out[2 * row + 1] = m[2] * in[2 * row] + m[3] * in[2 * row + 1];
+        }
+    };
+
+    multiply(matrix, x.data(), work.q.data());
+    for (size_t i = 0; i < n; ++i) work.r[i] = b[i] - work.q[i];
+
+    const double threshold = static_cast<double>(tolerance) * tolerance * dot(b, b);
+    if (dot(work.r, work.r) <= threshold) return 0;
+
+    precondition(work.r, work.z);
+    work.p = work.z;
+    double rz = dot(work.r, work.z);
+
+    int iteration = 0;
+    while (iteration < maxIterations) {
+        ++iteration;
+        multiply(matrix, work.p.data(), work.q.data());
+        double pq = dot(work.p, work.q);
+        if (pq <= 0.0) break;
+        float alpha = static_cast<float>(rz / pq);
+        for (size_t i = 0; i < n; ++i) {
+            x[i] += alpha * work.p[i];
+            work.r[i] -= alpha * work.q[i];
+        }
+        if (dot(work.r, work.r) <= threshold) break;
+
+        precondition(work.r, work.z);
+        double rzNext = dot(work.r, work.z);
+        float beta = static_cast<float>(rzNext / rz);
+        rz = rzNext;
+        for (size_t i = 0; i < n; ++i) work.p[i] = work.z[i] + beta * work.p[i];
+    }
+    return iteration;
+}
@@ -0,0 +1,235 @@
+#pragma once
+
+// Draws many equal-radius circles in one call. The circle outline is built once
+// into a vertex buffer and particle centres are streamed into an instance
+// buffer, so a frame costs one draw call instead of one glBegin/glEnd (and 360
+// cos/sin pairs) per particle. Contexts without instancing fall back to smooth
+// point sprites from a client-side array. Coordinates are the programs' default
+// [-1, 1] clip space, as with the immediate-mode drawing this replaces.
+
+#include <GL/glew.h>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+const int CIRCLE_SEGMENTS = 64;
+const int INSTANCE_REGIONS = 3; // regions of the persistent buffer in flight
+
+struct CircleRenderer {
+    bool instanced = false;
+    bool persistent = false;  // instance buffer mapped once, written in place
+    GLuint program = 0;
+    GLuint vao = 0;
+    GLuint circleVbo = 0;
+    GLuint instanceVbo = 0;
+    GLint radiusLocation = -1;
+    GLint colorLocation = -1;
+    size_t capacity = 0;      // instances per region
+    float* mapped = nullptr;
+    int region = 0;
+    GLsync fences[INSTANCE_REGIONS] = {};
+    std::vector<float> staging; // interleaved centres for the point-sprite path
+};
+
+inline GLuint compileShader(GLenum type, const char* source) {
+    GLuint shader = glCreateShader(type);
+    glShaderSource(shader, 1, &source, nullptr);
+    glCompileShader(shader);
+    GLint ok = GL_FALSE;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &ok);
+    if (!ok) {
+        char log[1024];
+        glGetShaderInfoLog(shader, sizeof(log), nullptr, log);
+        std::cerr << "Shader compilation failed: " << log << "\n";
+        glDeleteShader(shader);
+        return 0;
+    }
+    return shader;
+}
+
+inline GLuint linkCircleProgram() {
+    const char* vertexSource =
+        "#version 330\n"
+        "layout(location = 0) in vec2 offset;\n"
+        "layout(location = 1) in float centerX;\n"
+        "layout(location = 2) in float centerY;\n"
+        "uniform float radius;\n"
+        "void main() {\n"
+        "    gl_Position = vec4(vec2(centerX, centerY) + offset * radius, 0.0, 1.0);\n"
+        "}\n";
+    const char* fragmentSource =
+        "#version 330\n"
+        "uniform vec3 color;\n"
+        "out vec4 fragColor;\n"
+        "void main() {\n"
+        "    fragColor = vec4(color, 1.0);\n"
+        "}\n";
+
+    GLuint vertex = compileShader(GL_VERTEX_SHADER, vertexSource);
+    GLuint fragment = compileShader(GL_FRAGMENT_SHADER, fragmentSource);
+    if (!vertex || !fragment) return 0;
+
+    GLuint program = glCreateProgram();
+    glAttachShader(program, vertex);
+    glAttachShader(program, fragment);
+    glLinkProgram(program);
+    glDeleteShader(vertex);
+    glDeleteShader(fragment);
+
+    GLint ok = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &ok);
+    if (!ok) {
+        glDeleteProgram(program);
+        return 0;
+    }
+    return program;
+}
+
+// (Re)creates the instance buffer with room for `capacity` circles per region.
+inline void allocateInstances(CircleRenderer& renderer, size_t capacity) {
+    for (GLsync& fence : renderer.fences) {
+        if (fence) glDeleteSync(fence);
+        fence = nullptr;
+    }
+    if (renderer.instanceVbo) {
+        glBindBuffer(GL_ARRAY_BUFFER, renderer.instanceVbo);
+        if (renderer.mapped) glUnmapBuffer(GL_ARRAY_BUFFER);
+        glDeleteBuffers(1, &renderer.instanceVbo);
+        renderer.mapped = nullptr;
+    }
+
+    renderer.capacity = capacity;
+    renderer.region = 0;
+    glGenBuffers(1, &renderer.instanceVbo);
+    glBindBuffer(GL_ARRAY_BUFFER, renderer.instanceVbo);
+
+    // Each region holds every x, then every y, matching the SoA particle arrays.
+    GLsizeiptr bytes = static_cast<GLsizeiptr>(capacity * 2 * sizeof(float));
+    if (renderer.persistent) {
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_ARRAY_BUFFER, bytes * INSTANCE_REGIONS, nullptr, flags);
+        renderer.mapped = static_cast<float*>(glMapBufferRange(GL_ARRAY_BUFFER, 0, bytes * INSTANCE_REGIONS, flags));
+    } else {
+        glBufferData(GL_ARRAY_BUFFER, bytes, nullptr, GL_STREAM_DRAW);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+// Call once after glewInit().
+inline void initCircleRenderer(CircleRenderer& renderer) {
+    if (GLEW_VERSION_3_3 || GLEW_ARB_instanced_arrays) {
+        renderer.program = linkCircleProgram();
+    }
+    renderer.instanced = renderer.program != 0;
+    if (!renderer.instanced) {
+        std::cerr << "Instanced rendering unavailable, drawing particles as point sprites\n";
+        return;
+    }
+    renderer.persistent = GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage;
+    renderer.radiusLocation = glGetUniformLocation(renderer.program, "radius");
+    renderer.colorLocation = glGetUniformLocation(renderer.program, "color");
+
+    std::vector<float> fan = { 0.0f, 0.0f };
+    for (int i = 0; i <= CIRCLE_SEGMENTS; ++i) {
+        float angle = 2.0f * 3.14159265358979323846f * i / CIRCLE_SEGMENTS;
+        fan.push_back(std::cos(angle));
+        fan.push_back(std::sin(angle));
+    }
+
+    glGenVertexArrays(1, &renderer.vao);
+    glBindVertexArray(renderer.vao);
+    glGenBuffers(1, &renderer.circleVbo);
+    glBindBuffer(GL_ARRAY_BUFFER, renderer.circleVbo);
+    glBufferData(GL_ARRAY_BUFFER, fan.size() * sizeof(float), fan.data(), GL_STATIC_DRAW);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, nullptr);
+    glEnableVertexAttribArray(1);
+    glEnableVertexAttribArray(2);
+    glVertexAttribDivisor(1, 1);
+    glVertexAttribDivisor(2, 1);
+    glBindVertexArray(0);
+
+    allocateInstances(renderer, 1024);
+}
+
+inline void drawPointSprites(CircleRenderer& renderer, const float* x, const float* y, size_t count,
+                             float radius, float r, float g, float b) {
+    renderer.staging.resize(count * 2);
+    for (size_t i = 0; i < count; ++i) {
+        renderer.staging[2 * i] = x[i];
+        renderer.staging[2 * i + 1] = y[i];
+    }
+
+    // Clip space is two units across, so the radius in pixels is radius * size / 2.
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    float diameter = radius * static_cast<float>(std::min(viewport[2], viewport[3]));
+
+    glEnable(GL_POINT_SMOOTH);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glPointSize(diameter);
+    glColor3f(r, g, b);
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glVertexPointer(2, GL_FLOAT, 0, renderer.staging.data());
+    glDrawArrays(GL_POINTS, 0, static_cast<GLsizei>(count));
+    glDisableClientState(GL_VERTEX_ARRAY);
+    glDisable(GL_BLEND);
+    glDisable(GL_POINT_SMOOTH);
+}
+
+inline void drawCircles(CircleRenderer& renderer, const float* x, const float* y, size_t count,
+                        float radius, float r, float g, float b) {
+    if (count == 0) return;
+    if (!renderer.instanced) {
+        drawPointSprites(renderer, x, y, count, radius, r, g, b);
+        return;
+    }
+
+    if (count > renderer.capacity) {
+        size_t capacity = renderer.capacity;
+        while (capacity < count) capacity *= 2;
+        allocateInstances(renderer, capacity);
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, renderer.instanceVbo);
+    size_t regionOffset = 0;
+    if (renderer.persistent) {
+        // Wait until the GPU has finished reading this region three frames ago.
+        GLsync& fence = renderer.fences[renderer.region];
+        if (fence) {
+            glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+            glDeleteSync(fence);
+            fence = nullptr;
+        }
+        regionOffset = renderer.region * renderer.capacity * 2;
+        std::memcpy(renderer.mapped + regionOffset, x, count * sizeof(float));
+        std::memcpy(renderer.mapped + regionOffset + renderer.capacity, y, count * sizeof(float));
+    } else {
+        // Orphan the previous contents so the driver need not sync on them.
+        glBufferData(GL_ARRAY_BUFFER, renderer.capacity * 2 * sizeof(float), nullptr, GL_STREAM_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, count * sizeof(float), x);
+        glBufferSubData(GL_ARRAY_BUFFER, renderer.capacity * sizeof(float), count * sizeof(float), y);
+    }
+
+    glUseProgram(renderer.program);
+    glUniform1f(renderer.radiusLocation, radius);
+    glUniform3f(renderer.colorLocation, r, g, b);
+    glBindVertexArray(renderer.vao);
+    glVertexAttribPointer(1, 1, GL_FLOAT, GL_FALSE, 0,
+                          reinterpret_cast<const void*>(regionOffset * sizeof(float)));
+    glVertexAttribPointer(2, 1, GL_FLOAT, GL_FALSE, 0,
+                          reinterpret_cast<const void*>((regionOffset + renderer.capacity) * sizeof(float)));
+    glDrawArraysInstanced(GL_TRIANGLE_FAN, 0, CIRCLE_SEGMENTS + 2, static_cast<GLsizei>(count));
+    glBindVertexArray(0);
+    glUseProgram(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    if (renderer.persistent) {
+        renderer.fences[renderer.region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        renderer.region = (renderer.region + 1) % INSTANCE_REGIONS;
+    }
+}
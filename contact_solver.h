@@ -0,0 +1,212 @@
+#pragma once
+
+// XPBD contact solver for equal-mass discs. Contacts gathered by a broadphase
+// are projected apart over a fixed number of iterations per substep instead
+// of once each, accumulating a Lagrange multiplier per contact so a non-zero
+// compliance gives soft contacts whose stiffness does not depend on the
+// iteration count.
+//
+// Contacts are greedily graph coloured so that no two in a colour share a
+// particle. Each colour is then split into chunks that run in parallel on the
+// work pool; a chunk gathers its contacts' positions into contiguous arrays,
+// projects them with the SIMD lane kernels and scatters the results back.
+// The few contacts of a particle with too many neighbours to colour are
+// projected serially after the coloured batches.
+//
+// Walls are projected inside the same iterations through a callback, since a
+// pile pressed against one would otherwise be pushed through it by the
+// contacts and back into them by the walls on every substep.
+//
+// Every iteration measures the deepest penetration it started from, so
+// callers can stop early below a tolerance and report how converged the
+// solve was.
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include "particle_store.h"
+#include "work_pool.h"
+
+const int CONTACT_COLOURS = 64;           // colours tracked per particle bitmask
+const int CONTACT_SERIAL = CONTACT_COLOURS; // bucket for contacts that found no colour
+const int CONTACT_CHUNK = 256;            // contacts per parallel task
+
+struct ContactSettings {
+    int iterations = 4;
+    float compliance = 0.0f; // inverse stiffness; 0 is rigid
+    float tolerance = 0.0f;  // stop once penetration is no deeper than this
+};
+
+struct ContactSolver {
+    std::vector<uint32_t> pairI, pairJ; // as gathered
+    std::vector<uint8_t> colourOf;
+    std::vector<uint64_t> usedColours;  // per particle
+    int colourStart[CONTACT_COLOURS + 2] = {};
+
+    // In colour order
+    std::vector<uint32_t> contactI, contactJ;
+    FloatArray xi, yi, xj, yj, lambda, penetration;
+
+    // Statistics of the last solve
+    int iterationsRun = 0;
+    float residual = 0.0f; // deepest penetration the last iteration started from
+};
+
+inline void clearContacts(ContactSolver& solver) {
+    solver.pairI.clear();
+    solver.pairJ.clear();
+}
+
+inline void addContact(ContactSolver& solver, int i, int j) {
+    solver.pairI.push_back(static_cast<uint32_t>(i));
+    solver.pairJ.push_back(static_cast<uint32_t>(j));
+}
+
+// Sizes the buffers for `contacts` contacts among `particles` particles, so a
+// solve within those sizes allocates nothing.
+inline void reserveContacts(ContactSolver& solver, std::size_t contacts, std::size_t particles) {
+    std::vector<uint32_t>* indices[4] = { &solver.pairI, &solver.pairJ, &solver.contactI, &solver.contactJ };
+    for (auto* array : indices) array->reserve(contacts);
+    FloatArray* values[6] = { &solver.xi, &solver.yi, &solver.xj, &solver.yj, &solver.lambda, &solver.penetration };
+    for (FloatArray* array : values) array->reserve(contacts);
+    solver.colourOf.reserve(contacts);
+    solver.usedColours.reserve(particles);
+}
+
+// Greedy colouring in gathered order, then a counting sort by colour.
+inline void colourContacts(ContactSolver& solver, std::size_t particleCount) {
+    const std::size_t count = solver.pairI.size();
+    solver.usedColours.assign(particleCount, 0);
+    solver.colourOf.resize(count);
+    int colourCount[CONTACT_COLOURS + 1] = {};
+    for (std::size_t c = 0; c < count; ++c) {
+        uint64_t used = solver.usedColours[solver.pairI[c]] | solver.usedColours[solver.pairJ[c]];
+        int colour = ~used ? __builtin_ctzll(~used) : CONTACT_SERIAL;
+        if (colour != CONTACT_SERIAL) {
+            solver.usedColours[solver.pairI[c]] |= uint64_t(1) << colour;
+            solver.usedColours[solver.pairJ[c]] |= uint64_t(1) << colour;
+        }
+        solver.colourOf[c] = static_cast<uint8_t>(colour);
+        colourCount[colour]++;
+    }
+    solver.colourStart[0] = 0;
+    for (int colour = 0; colour <= CONTACT_COLOURS; ++colour) {
+        solver.colourStart[colour + 1] = solver.colourStart[colour] + colourCount[colour];
+    }
+    solver.contactI.resize(count);
+    solver.contactJ.resize(count);
+    int next[CONTACT_COLOURS + 1];
+    std::copy(solver.colourStart, solver.colourStart + CONTACT_COLOURS + 1, next);
+    for (std::size_t c = 0; c < count; ++c) {
+        int slot = next[solver.colourOf[c]]++;
+        solver.contactI[slot] = solver.pairI[c];
+        solver.contactJ[slot] = solver.pairJ[c];
+    }
+}
+
+// One projection of each contact in [i, i + width): moves both discs apart
+// along the contact normal by the change in the contact's multiplier, which
+// never goes negative, so contacts only push.
+template <typename L>
+struct ContactKernel {
+    static void run(std::size_t i, float* xi, float* yi, float* xj, float* yj, float* lambda, float* penetration,
+                    float restLength, float alphaTilde) {
+        L ax = L::load(xi + i), ay = L::load(yi + i);
+        L bx = L::load(xj + i), by = L::load(yj + i);
+        L dx = bx - ax, dy = by - ay;
+        L distance = sqrt(dx * dx + dy * dy);
+        L zero = L::splat(0.0f);
+        // Coincident discs (two clamped into the same corner) have no normal;
+        // separate them along x.
+        auto coincident = lessThan(distance, L::splat(1e-12f));
+        dx = select(coincident, L::splat(1.0f), dx);
+        dy = select(coincident, zero, dy);
+        L safe = select(coincident, L::splat(1.0f), distance);
+        L c = distance - L::splat(restLength);
+        L lam = L::load(lambda + i);
+        L alpha = L::splat(alphaTilde);
+        L next = lam + (zero - c - alpha * lam) / (L::splat(2.0f) + alpha);
+        next = select(lessThan(next, zero), zero, next);
+        L delta = next - lam;
+        L nx = dx / safe * delta, ny = dy / safe * delta;
+        (ax - nx).store(xi + i);
+        (ay - ny).store(yi + i);
+        (bx + nx).store(xj + i);
+        (by + ny).store(yj + i);
+        next.store(lambda + i);
+        select(lessThan(c, zero), zero - c, zero).store(penetration + i);
+    }
+};
+
+inline void projectContacts(ContactSolver& solver, float* posX, float* posY, int begin, int end,
+                            float restLength, float alphaTilde) {
+    for (int c = begin; c < end; ++c) {
+        solver.xi[c] = posX[solver.contactI[c]];
+        solver.yi[c] = posY[solver.contactI[c]];
+        solver.xj[c] = posX[solver.contactJ[c]];
+        solver.yj[c] = posY[solver.contactJ[c]];
+    }
+    forEachLane<ContactKernel>(end - begin, solver.xi.data() + begin, solver.yi.data() + begin,
+                               solver.xj.data() + begin, solver.yj.data() + begin, solver.lambda.data() + begin,
+                               solver.penetration.data() + begin, restLength, alphaTilde);
+    for (int c = begin; c < end; ++c) {
+        posX[solver.contactI[c]] = solver.xi[c];
+        posY[solver.contactI[c]] = solver.yi[c];
+        posX[solver.contactJ[c]] = solver.xj[c];
+        posY[solver.contactJ[c]] = solver.yj[c];
+    }
+}
+
+// Solves the gathered contacts between discs whose centres rest `restLength`
+// apart, calling projectBoundary() after each iteration. Positions are
+// updated in place; with Verlet integration the corrections become velocity
+// on their own.
+template <typename Boundary>
+void solveContacts(ContactSolver& solver, StealingPool& pool, float* posX, float* posY, std::size_t particleCount,
+                   float restLength, float dt, const ContactSettings& settings, Boundary&& projectBoundary) {
+    colourContacts(solver, particleCount);
+    const int count = static_cast<int>(solver.contactI.size());
+    FloatArray* values[6] = { &solver.xi, &solver.yi, &solver.xj, &solver.yj, &solver.lambda, &solver.penetration };
+    for (FloatArray* array : values) array->resize(count);
+    std::fill(solver.lambda.begin(), solver.lambda.end(), 0.0f);
+    const float alphaTilde = settings.compliance / (dt * dt);
+
+    solver.iterationsRun = 0;
+    solver.residual = 0.0f;
+    for (int iteration = 0; iteration < settings.iterations && count > 0; ++iteration) {
+        for (int colour = 0; colour < CONTACT_COLOURS; ++colour) {
+            const int begin = solver.colourStart[colour];
+            const int size = solver.colourStart[colour + 1] - begin;
+            runTasks(pool, (size + CONTACT_CHUNK - 1) / CONTACT_CHUNK, [&](int task, int) {
+                int first = begin + task * CONTACT_CHUNK;
+                projectContacts(solver, posX, posY, first, std::min(first + CONTACT_CHUNK, begin + size),
+                                restLength, alphaTilde);
+            });
+        }
+        for (int c = solver.colourStart[CONTACT_SERIAL]; c < count; ++c) {
+            projectContacts(solver, posX, posY, c, c + 1, restLength, alphaTilde);
+        }
+        projectBoundary();
+        solver.iterationsRun++;
+        solver.residual = *std::max_element(solver.penetration.begin(), solver.penetration.end());
+        if (solver.residual <= settings.tolerance) break;
+    }
+}
+
+// Consumes argv[i] (and its value) if it is a contact solver option.
+inline bool parseContactOption(int& i, int argc, char** argv, ContactSettings& settings) {
+    if (i + 1 >= argc) return false;
+    if (std::strcmp(argv[i], "--iterations") == 0) {
+        settings.iterations = std::max(1, std::atoi(argv[++i]));
+    } else if (std::strcmp(argv[i], "--compliance") == 0) {
+        settings.compliance = std::max(0.0f, static_cast<float>(std::atof(argv[++i])));
+    } else if (std::strcmp(argv[i], "--tolerance") == 0) {
+        settings.tolerance = std::max(0.0f, static_cast<float>(std::atof(argv[++i])));
+    } else {
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+// Fixed-timestep scheduler shared by the simulations. Frame time is banked in
+// an accumulator and spent in whole physics ticks of 1 / rate seconds, each
+// split into `substeps` integrator calls, so the physics advances at the same
+// rate whatever the display does. A frame never runs more than maxTicks ticks;
+// time beyond that is dropped rather than carried over, so one slow frame
+// cannot snowball into ever longer ones. Whatever is left in the accumulator
+// is the fraction of a tick rendering should interpolate by.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+struct FixedStep {
+    float rate = 120.0f; // ticks per second
+    int substeps = 1;    // integrator calls per tick
+    int maxTicks = 8;    // ticks per frame before frame time is dropped
+    double accumulator = 0.0;
+    double lastTime = -1.0;
+};
+
+// Consumes argv[i] (and its value) if it is a timestep option.
+inline bool parseFixedStepOption(int& i, int argc, char** argv, FixedStep& clock) {
+    if (i + 1 >= argc) return false;
+    if (std::strcmp(argv[i], "--hz") == 0) {
+        clock.rate = std::max(1.0f, static_cast<float>(std::atof(argv[++i])));
+    } else if (std::strcmp(argv[i], "--substeps") == 0) {
+        clock.substeps = std::max(1, std::atoi(argv[++i]));
+    } else if (std::strcmp(argv[i], "--max-ticks") == 0) {
+        clock.maxTicks = std::max(1, std::atoi(argv[++i]));
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// Raises maxTicks so a frame of `frameTime` seconds is never cut short. For
+// clocks driven by a fixed frame time rather than the wall clock, such as
+// offscreen output, where a frame's time must all be simulated.
+inline void allowFrameTime(FixedStep& clock, double frameTime) {
+    clock.maxTicks = std::max(clock.maxTicks, static_cast<int>(std::ceil(frameTime * clock.rate)));
+}
+
+inline float tickDt(const FixedStep& clock) {
+    return 1.0f / clock.rate;
+}
+
+inline float substepDt(const FixedStep& clock) {
+    return 1.0f / (clock.rate * clock.substeps);
+}
+
+// Banks the time since the previous call and returns how many ticks to run.
+inline int consumeTicks(FixedStep& clock, double now) {
+    if (clock.lastTime < 0.0) clock.lastTime = now;
+    double tick = 1.0 / clock.rate;
+    double frameTime = std::min(now - clock.lastTime, clock.maxTicks * tick);
+    clock.lastTime = now;
+
+    clock.accumulator += std::max(0.0, frameTime);
+    int ticks = static_cast<int>(clock.accumulator / tick);
+    clock.accumulator -= ticks * tick;
+    return ticks;
+}
+
+// How far between the last two ticks the current frame falls, in [0, 1).
+inline float interpolationAlpha(const FixedStep& clock) {
+    return static_cast<float>(clock.accumulator * clock.rate);
+}
@@ -0,0 +1,151 @@
+#pragma once
+
+// Offscreen output: instead of showing frames in a window, a program renders
+// each one into a framebuffer object and streams it as raw RGBA, top row
+// first, to a file or to stdout. The simulation clock advances a fixed 1 / fps
+// per frame rather than following the wall clock, so runs are as fast as the
+// machine allows and come out the same every time, e.g.
+//
+//   ./particles2 --load run.snap --output - --frames 36000 |
+//       ffmpeg -f rawvideo -pix_fmt rgba -s 640x640 -r 60 -i - run.mp4
+//
+// Readback is asynchronous: glReadPixels copies each frame into the next of a
+// ring of pixel buffer objects and returns at once, and a buffer is mapped and
+// written out only when the ring comes back round to it, by which time the GPU
+// has long finished the copy.
+
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+const int OUTPUT_BUFFERS = 3; // frames in flight between render and write
+
+struct OutputOptions {
+    const char* path = nullptr; // "-" for stdout
+    long long frames = 600;
+    double fps = 60.0;
+};
+
+struct FrameOutput {
+    std::FILE* file = nullptr;
+    int width = 0;
+    int height = 0;
+    GLuint framebuffer = 0;
+    GLuint colour = 0;
+    GLuint pixelBuffers[OUTPUT_BUFFERS] = {};
+    long long submitted = 0; // frames read back
+    long long written = 0;   // frames written out
+    bool failed = false;
+};
+
+// Consumes argv[i] (and its value) if it is an output option.
+inline bool parseOutputOption(int& i, int argc, char** argv, OutputOptions& options) {
+    if (i + 1 >= argc) return false;
+    if (std::strcmp(argv[i], "--output") == 0) {
+        options.path = argv[++i];
+    } else if (std::strcmp(argv[i], "--frames") == 0) {
+        options.frames = std::max(1LL, std::atoll(argv[++i]));
+    } else if (std::strcmp(argv[i], "--fps") == 0) {
+        options.fps = std::max(1.0, std::atof(argv[++i]));
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// The window only provides the GL context, so it stays hidden. Call before
+// glfwCreateWindow().
+inline void hideOutputWindow(const OutputOptions& options) {
+    if (options.path) glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+}
+
+// Simulation time of frame `frame`.
+inline double outputTime(const OutputOptions& options, long long frame) {
+    return frame / options.fps;
+}
+
+inline bool outputComplete(const FrameOutput& output, const OutputOptions& options) {
+    return output.failed || output.submitted >= options.frames;
+}
+
+// Opens the destination and creates a width x height framebuffer, which stays
+// bound so everything drawn afterwards lands in it. Call after glewInit().
+inline bool beginFrameOutput(FrameOutput& output, const OutputOptions& options, int width, int height) {
+    output.file = std::strcmp(options.path, "-") == 0 ? stdout : std::fopen(options.path, "wb");
+    if (!output.file) {
+        std::cerr << "Cannot write frames to " << options.path << std::endl;
+        return false;
+    }
+    output.width = width;
+    output.height = height;
+
+    glGenRenderbuffers(1, &output.colour);
+    glBindRenderbuffer(GL_RENDERBUFFER, output.colour);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+    glGenFramebuffers(1, &output.framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, output.framebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, output.colour);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cerr << "Cannot create a " << width << "x" << height << " framebuffer" << std::endl;
+        return false;
+    }
+    glViewport(0, 0, width, height);
+
+    const GLsizeiptr frameBytes = static_cast<GLsizeiptr>(width) * height * 4;
+    glGenBuffers(OUTPUT_BUFFERS, output.pixelBuffers);
+    for (GLuint buffer : output.pixelBuffers) {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer);
+        glBufferData(GL_PIXEL_PACK_BUFFER, frameBytes, nullptr, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    return true;
+}
+
+// Maps the oldest frame in flight and writes it, flipping GL's bottom-up rows.
+inline void writeOldestFrame(FrameOutput& output) {
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, output.pixelBuffers[output.written % OUTPUT_BUFFERS]);
+    const auto* pixels = static_cast<const unsigned char*>(glMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY));
+    if (pixels) {
+        const size_t rowBytes = static_cast<size_t>(output.width) * 4;
+        for (int y = output.height - 1; y >= 0 && !output.failed; --y) {
+            output.failed = std::fwrite(pixels + y * rowBytes, 1, rowBytes, output.file) != rowBytes;
+        }
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    } else {
+        output.failed = true;
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    output.written++;
+}
+
+// Queues the readback of the frame just drawn, writing out the frame that was
+// queued OUTPUT_BUFFERS frames ago to make room.
+inline void submitFrame(FrameOutput& output) {
+    if (output.submitted - output.written == OUTPUT_BUFFERS) writeOldestFrame(output);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, output.pixelBuffers[output.submitted % OUTPUT_BUFFERS]);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glReadPixels(0, 0, output.width, output.height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    output.submitted++;
+}
+
+// Writes the frames still in flight and closes the destination.
+inline bool finishFrameOutput(FrameOutput& output, const OutputOptions& options) {
+    if (!output.file) return true;
+    while (output.written < output.submitted) writeOldestFrame(output);
+    glDeleteBuffers(OUTPUT_BUFFERS, output.pixelBuffers);
+    glDeleteFramebuffers(1, &output.framebuffer);
+    glDeleteRenderbuffers(1, &output.colour);
+    bool ok = std::fflush(output.file) == 0 && !output.failed;
+    if (output.file != stdout) ok = std::fclose(output.file) == 0 && ok;
+    output.file = nullptr;
+    if (!ok) std::cerr << "Failed writing frames to " << options.path << std::endl;
+    else std::cerr << "Wrote " << output.written << " " << output.width << "x" << output.height
+                   << " RGBA frames to " << options.path << std::endl;
+    return ok;
+}
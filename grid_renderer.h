@@ -0,0 +1,94 @@
+#pragma once
+
+// Draws a grid of cells as one texture. The board is uploaded as a
+// single-channel (luminance) texture with one texel per cell, and drawn as a
+// single nearest-filtered quad, so pan and zoom only change where the quad
+// goes. Only rows that changed since the last upload are sent, in contiguous
+// spans through glTexSubImage2D. Cells come in packed 64 per word, as in the
+// bit-packed engines, and are expanded to bytes for the rows that changed.
+
+#include <GL/glew.h>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+struct GridRenderer {
+    GLuint texture = 0;
+    int width = 0;  // texels, one per cell
+    int height = 0;
+    int wordsPerRow = 0;
+    std::vector<uint64_t> uploaded; // packed rows as last sent, for finding dirty rows
+    std::vector<uint8_t> staging;   // 0 or 255 per cell, row-major
+};
+
+// Call once after glewInit().
+inline void initGridRenderer(GridRenderer& renderer) {
+    glGenTextures(1, &renderer.texture);
+    glBindTexture(GL_TEXTURE_2D, renderer.texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    // Zoomed out below a pixel per cell, neighbouring cells blend to grey.
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+// Uploads a width x height grid stored as rows of packed 64-bit words (bit x of
+// word x / 64 is cell x). Bits past `width` in the last word of a row must be
+// zero. The texture is reallocated only when the size changes.
+inline void uploadGridRows(GridRenderer& renderer, const uint64_t* words, int wordsPerRow, int width, int height) {
+    glBindTexture(GL_TEXTURE_2D, renderer.texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    const size_t rowWords = static_cast<size_t>(wordsPerRow);
+    bool resized = width != renderer.width || height != renderer.height || wordsPerRow != renderer.wordsPerRow;
+    if (resized) {
+        renderer.width = width;
+        renderer.height = height;
+        renderer.wordsPerRow = wordsPerRow;
+        renderer.uploaded.assign(rowWords * height, 0);
+        renderer.staging.assign(static_cast<size_t>(width) * height, 0);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_LUMINANCE8, width, height, 0, GL_LUMINANCE, GL_UNSIGNED_BYTE, nullptr);
+    }
+
+    int spanStart = -1;
+    for (int y = 0; y <= height; ++y) {
+        bool dirty = false;
+        if (y < height) {
+            const uint64_t* row = words + y * rowWords;
+            uint64_t* last = renderer.uploaded.data() + y * rowWords;
+            dirty = resized || std::memcmp(row, last, rowWords * sizeof(uint64_t)) != 0;
+            if (dirty) {
+                std::memcpy(last, row, rowWords * sizeof(uint64_t));
+                uint8_t* out = renderer.staging.data() + static_cast<size_t>(y) * width;
+                for (int x = 0; x < width; ++x) {
+                    out[x] = ((row[x >> 6] >> (x & 63)) & 1) ? 255 : 0;
+                }
+            }
+        }
+        if (dirty && spanStart < 0) {
+            spanStart = y;
+        } else if (!dirty && spanStart >= 0) {
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, spanStart, width, y - spanStart, GL_LUMINANCE, GL_UNSIGNED_BYTE,
+                            renderer.staging.data() + static_cast<size_t>(spanStart) * width);
+            spanStart = -1;
+        }
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+// Draws the uploaded grid over the rectangle (left, top)-(right, bottom) of
+// the current projection, texel (0, 0) at the top-left.
+inline void drawGridTexture(const GridRenderer& renderer, float left, float top, float right, float bottom) {
+    if (renderer.width == 0 || renderer.height == 0) return;
+    glEnable(GL_TEXTURE_2D);
+    glBindTexture(GL_TEXTURE_2D, renderer.texture);
+    glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_REPLACE);
+    glBegin(GL_QUADS);
+    glTexCoord2f(0.0f, 0.0f); glVertex2f(left, top);
+    glTexCoord2f(1.0f, 0.0f); glVertex2f(right, top);
+    glTexCoord2f(1.0f, 1.0f); glVertex2f(right, bottom);
+    glTexCoord2f(0.0f, 1.0f); glVertex2f(left, bottom);
+    glEnd();
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glDisable(GL_TEXTURE_2D);
+}
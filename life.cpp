@@ -1,20 +1,218 @@
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
-#include <array>
+#include <sys/mman.h>
 #include <iostream>
 #include <cstdlib>
 #include <ctime>
 #include <algorithm>
+#include <atomic>
 #include <thread>
 #include <chrono>
+#include <random>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <new>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+#include "bench.h"
+#include "frame_output.h"
+#include "grid_renderer.h"
+#include "life_pattern.h"
+#include "life_rule.h"
+#include "pipeline.h"
+#include "profiler.h"
+#include "snapshot.h"
+#include "work_pool.h"
 
-const int GAME_WIDTH = 100;
-const int GAME_HEIGHT = 100;
-const int CELL_SIZE = 10;
+const int DEFAULT_BOARD_SIZE = 100; // cells across and down, unless set with --board-size
+const int CELL_SIZE = 10;           // pixels per cell while the board fits the window
+const int MAX_WINDOW_PIXELS = 1000; // larger boards shrink their cells to fit
 const int DELAY = 70;
 
-bool isAlive(
-    const std::array<std::array<int, GAME_HEIGHT>, GAME_WIDTH>& game,
+const size_t CELL_ALIGNMENT = 64; // a cache line, and the widest vector load
+const size_t HUGE_PAGE_BYTES = size_t(2) << 20;
+
+// Allocates board cells aligned to CELL_ALIGNMENT or, with huge pages, in
+// whole 2 MiB pages that the kernel is asked to back with transparent huge
+// pages, so stepping a large board misses the TLB far less often.
+template <typename T>
+struct CellAllocator {
+    using value_type = T;
+    using propagate_on_container_copy_assignment = std::true_type;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+
+    bool hugePages = false;
+
+    CellAllocator() = default;
+    explicit CellAllocator(bool hugePages) : hugePages(hugePages) {}
+    template <typename U> CellAllocator(const CellAllocator<U>& other) : hugePages(other.hugePages) {}
+
+    T* allocate(size_t n) {
+        size_t alignment = hugePages ? HUGE_PAGE_BYTES : CELL_ALIGNMENT;
+        size_t bytes = (n * sizeof(T) + alignment - 1) / alignment * alignment;
+        void* cells = std::aligned_alloc(alignment, bytes);
+        if (!cells) throw std::bad_alloc();
+        if (hugePages) madvise(cells, bytes, MADV_HUGEPAGE);
+        return static_cast<T*>(cells);
+    }
+    void deallocate(T* cells, size_t) {
+        std::free(cells);
+    }
+
+    template <typename U> bool operator==(const CellAllocator<U>& other) const { return hugePages == other.hugePages; }
+    template <typename U> bool operator!=(const CellAllocator<U>& other) const { return hugePages != other.hugePages; }
+};
+
+// The fixed-size board, or the window's viewport of an unbounded one, on the
+// heap. Cells are stored column by column and read as game[x][y]; each column
+// is padded to whole cache lines, so every one starts on a vector boundary.
+struct Board {
+    int width = 0;
+    int height = 0;
+    int stride = 0; // cells from one column to the next
+    std::vector<int, CellAllocator<int>> cells;
+
+    int* operator[](int x) { return cells.data() + static_cast<size_t>(x) * stride; }
+    const int* operator[](int x) const { return cells.data() + static_cast<size_t>(x) * stride; }
+};
+
+enum class Engine {
+    Scalar,    // nextState per cell, the reference implementation; the only engine for Generations rules
+    BitPacked, // 64 cells per word, neighbour counts from bitwise adders
+    Verify,    // runs both and reports any cell where they disagree
+    HashLife,  // unbounded quadtree universe, advancing 2^k generations a step
+    Tiled      // unbounded sparse board, stepping only tiles near activity
+};
+
+// Board stored one bit per cell, rows of 64-bit words along x.
+struct BitBoard {
+    int width = 0;
+    int height = 0;
+    int wordsPerRow = 0;
+    std::vector<uint64_t> words;
+};
+
+const uint32_t NO_NODE = 0xffffffffu;
+const uint8_t FREE_LEVEL = 0xff;
+
+struct HashNode {
+    uint32_t nw = 0, ne = 0, sw = 0, se = 0;
+    uint32_t next = NO_NODE;   // hash chain
+    uint32_t result = NO_NODE; // memoized successor
+    uint64_t population = 0;
+    uint8_t level = 0;
+    int8_t resultStep = -1;    // log2 of the generations `result` advanced
+    bool marked = false;
+};
+
+struct HashLife {
+    std::vector<HashNode> nodes;
+    std::vector<uint32_t> buckets;    // heads of the hash chains
+    std::vector<uint32_t> freeList;
+    std::vector<uint32_t> emptyNodes; // canonical empty node per level
+    uint32_t root = NO_NODE;          // centred on cell (0, 0)
+    size_t liveNodes = 0;
+    size_t maxNodes = 0;
+    uint64_t generation = 0;
+};
+
+const int TILE_SIZE = 64; // one 64-bit word per tile row
+
+struct Tile {
+    uint64_t rows[TILE_SIZE] = {}; // bit x of rows[y] is cell (x, y) of the tile
+    uint64_t next[TILE_SIZE] = {};
+    uint64_t scheduledAt = 0;      // generation the tile was last queued for
+    bool changed = false;
+};
+
+struct TiledBoard {
+    std::unordered_map<uint64_t, Tile> tiles; // keyed by packed tile coordinates
+    std::vector<uint64_t> active;             // tiles changed last step or edited
+    std::vector<uint64_t> scheduled;
+    uint64_t generation = 0;
+};
+
+const double MIN_CELL_PIXELS = 0.25; // at most 4000 cells across the window
+const double MAX_CELL_PIXELS = 64.0;
+
+// What the window shows: the board cell at its top-left corner and the size of
+// a cell in pixels. `display` holds the cells from (boardX, boardY), which the
+// unbounded engines keep at the window's top-left cell; the fixed-size boards
+// start at 0.
+struct GridView {
+    double originX = 0.0;
+    double originY = 0.0;
+    double cellPixels = CELL_SIZE;
+    int64_t boardX = 0;
+    int64_t boardY = 0;
+};
+
+bool boardEdited = false;
+int generation = 0; // displayed steps run so far
+
+// The rule every engine steps, set by --rule or by a pattern's header and
+// compiled once before the first generation.
+LifeRule rule;
+
+// Snapshot and replay: --record saves the board recording started from plus
+// every cell edit, tagged with the generation it was made before; --load
+// restores a board and replays any edits it holds.
+InputRecorder editRecorder;
+InputReplay editReplay;
+MappedSnapshot loadedSnapshot;
+
+GridView gridView;
+
+// Pipelined mode (--pipelined): generations run on their own thread, which
+// owns every engine and publishes the cells to draw through a triple buffer.
+// Clicks, Enter and the region under the window reach it over a queue.
+struct LifeFrame {
+    BitBoard cells;
+    int64_t x = 0; // board cell at the top-left of `cells`
+    int64_t y = 0;
+};
+
+enum class LifeMessageKind {
+    Edit,  // cell (x, y) set alive
+    View,  // the window now shows width x height cells from (x, y)
+    Start  // Enter pressed
+};
+
+struct LifeMessage {
+    LifeMessageKind kind = LifeMessageKind::Edit;
+    int64_t x = 0;
+    int64_t y = 0;
+    int width = 0;
+    int height = 0;
+};
+
+bool pipelined = false;
+TripleBuffer<LifeFrame> lifeFrames;
+SpscQueue<LifeMessage, 1024> lifeMessages;
+std::atomic<bool> simulationRunning{false};
+
+Board makeBoard(int width, int height, bool hugePages) {
+    const int cellsPerLine = static_cast<int>(CELL_ALIGNMENT / sizeof(int));
+    Board game;
+    game.width = width;
+    game.height = height;
+    game.stride = (height + cellsPerLine - 1) / cellsPerLine * cellsPerLine;
+    game.cells = std::vector<int, CellAllocator<int>>(static_cast<size_t>(width) * game.stride, 0,
+                                                       CellAllocator<int>(hugePages));
+    return game;
+}
+
+void clearBoard(Board& game) {
+    std::fill(game.cells.begin(), game.cells.end(), 0);
+}
+
+// Next state of cell (x, y): the count of live neighbours and the cell's own
+// state index the rule's transition table.
+int nextState(
+    const Board& game,
     const int x,
     const int y
 ) {
@@ -22,39 +220,980 @@ bool isAlive(
     const int state = game[x][y];
 
     if (x > 0 && game[x-1][y] == 1) neighbors++;
-    if (x < GAME_WIDTH-1 && game[x+1][y] == 1) neighbors++;
+    if (x < game.width-1 && game[x+1][y] == 1) neighbors++;
     if (y > 0 && game[x][y-1] == 1) neighbors++;
-    if (y < GAME_HEIGHT-1 && game[x][y+1] == 1) neighbors++;
+    if (y < game.height-1 && game[x][y+1] == 1) neighbors++;
 
     if (x > 0 && y > 0 && game[x-1][y-1] == 1) neighbors++;
-    if (x > 0 && y < GAME_HEIGHT-1 && game[x-1][y+1] == 1) neighbors++;
-    if (x < GAME_WIDTH-1 && y > 0 && game[x+1][y-1] == 1) neighbors++;
-    if (x < GAME_WIDTH-1 && y < GAME_HEIGHT-1 && game[x+1][y+1] == 1) neighbors++;
+    if (x > 0 && y < game.height-1 && game[x-1][y+1] == 1) neighbors++;
+    if (x < game.width-1 && y > 0 && game[x+1][y-1] == 1) neighbors++;
+    if (x < game.width-1 && y < game.height-1 && game[x+1][y+1] == 1) neighbors++;
 
-    if (state == 1 && neighbors < 2) return false;
-    if (state == 1 && (neighbors == 2 || neighbors == 3)) return true;
-    if (state == 1 && neighbors > 5) return false;
-    if (state == 0 && neighbors == 3) return true;
+    return rule.transition[state * 9 + neighbors];
+}
 
-    return false;
+void stepScalarRows(const Board& game, Board& next, int firstRow, int lastRow) {
+    for (int x = 0; x < game.width; ++x) {
+        int* column = next[x]; // held, since stores through it could otherwise alias the board's size
+        for (int y = firstRow; y < lastRow; ++y) {
+            column[y] = nextState(game, x, y);
+        }
+    }
 }
 
-void drawGrid(const std::array<std::array<int, GAME_HEIGHT>, GAME_WIDTH>& game) {
-    glBegin(GL_QUADS);
-    for (int x = 0; x < GAME_WIDTH; ++x) {
-        for (int y = 0; y < GAME_HEIGHT; ++y) {
-            if (game[x][y] == 1) {
-                glColor3f(1.0f, 1.0f, 1.0f);
-            } else {
-                glColor3f(0.0f, 0.0f, 0.0f);
+void stepScalar(const Board& game, Board& next) {
+    stepScalarRows(game, next, 0, game.height);
+}
+
+BitBoard makeBitBoard(int width, int height) {
+    BitBoard bits;
+    bits.width = width;
+    bits.height = height;
+    bits.wordsPerRow = (width + 63) / 64;
+    bits.words.assign(static_cast<size_t>(bits.wordsPerRow) * height, 0);
+    return bits;
+}
+
+// Both directions go a word at a time down each band of 64 columns, so the
+// columns of the board stay in cache however tall it is.
+void packBoard(const Board& game, BitBoard& bits) {
+    const int* cells = game.cells.data();
+    for (int w = 0; w < bits.wordsPerRow; ++w) {
+        const int firstX = w * 64;
+        const int lastX = std::min(firstX + 64, game.width);
+        for (int y = 0; y < game.height; ++y) {
+            uint64_t word = 0;
+            for (int x = firstX; x < lastX; ++x) {
+                word |= uint64_t(cells[static_cast<size_t>(x) * game.stride + y] == 1) << (x - firstX);
+            }
+            bits.words[y * bits.wordsPerRow + w] = word;
+        }
+    }
+}
+
+void unpackBoard(const BitBoard& bits, Board& game) {
+    int* cells = game.cells.data();
+    const int width = game.width, height = game.height;
+    const size_t stride = game.stride;
+    for (int w = 0; w < bits.wordsPerRow; ++w) {
+        const int firstX = w * 64;
+        const int lastX = std::min(firstX + 64, width);
+        for (int y = 0; y < height; ++y) {
+            const uint64_t word = bits.words[y * bits.wordsPerRow + w];
+            for (int x = firstX; x < lastX; ++x) {
+                cells[x * stride + y] = (word >> (x - firstX)) & 1;
+            }
+        }
+    }
+}
+
+// Sum of three one-bit lanes as a two-bit number (ones, twos).
+inline void fullAdd(uint64_t a, uint64_t b, uint64_t c, uint64_t& ones, uint64_t& twos) {
+    uint64_t ab = a ^ b;
+    ones = ab ^ c;
+    twos = (a & b) | (ab & c);
+}
+
+// Neighbour counts are built for 64 cells at a time with bit-sliced adders.
+// mid[0..2] are the words above, at and below the cells being stepped; left and
+// right hold the words beside each of them, which supply the edge neighbours.
+// Each row's live neighbours come out as a two-bit number (ones, twos); the
+// middle row leaves out the cells themselves.
+inline void sumNeighbourRows(const uint64_t left[3], const uint64_t mid[3], const uint64_t right[3],
+                             uint64_t rowSum[3][2]) {
+    for (int r = 0; r < 3; ++r) {
+        // Bit x of `west` holds cell x-1, bit x of `east` holds cell x+1.
+        uint64_t west = (mid[r] << 1) | (left[r] >> 63);
+        uint64_t east = (mid[r] >> 1) | (right[r] << 63);
+        if (r == 1) {
+            rowSum[r][0] = west ^ east;
+            rowSum[r][1] = west & east;
+        } else {
+            fullAdd(west, mid[r], east, rowSum[r][0], rowSum[r][1]);
+        }
+    }
+}
+
+// B3/S23: a cell is alive next generation when it has three neighbours, or
+// two and is alive now.
+inline uint64_t stepWord(const uint64_t left[3], const uint64_t mid[3], const uint64_t right[3]) {
+    uint64_t rowSum[3][2];
+    sumNeighbourRows(left, mid, right, rowSum);
+
+    uint64_t ones, carry;
+    fullAdd(rowSum[0][0], rowSum[1][0], rowSum[2][0], ones, carry);
+
+    // Count = ones + 2 * (number of set twos lanes). It is 2 or 3 exactly
+    // when one of the four twos lanes is set.
+    uint64_t p = rowSum[0][1] ^ rowSum[1][1];
+    uint64_t q = rowSum[2][1] ^ carry;
+    uint64_t pairs = (rowSum[0][1] & rowSum[1][1]) | (rowSum[2][1] & carry);
+    uint64_t oneTwo = (p ^ q) & ~pairs;
+
+    return oneTwo & (ones | mid[1]);
+}
+
+// Any two-state rule. The count is summed into four bit planes, and every
+// count selects its cells with a mask from the rule's birth and survival
+// sets, so the rule costs no branches.
+inline uint64_t stepWordRule(const uint64_t left[3], const uint64_t mid[3], const uint64_t right[3],
+                             const LifeRule& rule) {
+    uint64_t rowSum[3][2];
+    sumNeighbourRows(left, mid, right, rowSum);
+
+    uint64_t planes[4], carry, twos, fours, carryFours;
+    fullAdd(rowSum[0][0], rowSum[1][0], rowSum[2][0], planes[0], carry);
+    fullAdd(rowSum[0][1], rowSum[1][1], rowSum[2][1], twos, fours);
+    planes[1] = twos ^ carry;
+    carryFours = twos & carry;
+    planes[2] = fours ^ carryFours;
+    planes[3] = fours & carryFours;
+
+    uint64_t born = 0, survives = 0;
+    for (int count = 0; count <= 8; ++count) {
+        uint64_t match = ~uint64_t(0);
+        for (int b = 0; b < 4; ++b) match &= (count >> b & 1) ? planes[b] : ~planes[b];
+        born |= match & (uint64_t(0) - (rule.birth >> count & 1));
+        survives |= match & (uint64_t(0) - (rule.survival >> count & 1));
+    }
+    return (born & ~mid[1]) | (survives & mid[1]);
+}
+
+// Word kernels for the bit-packed and tiled loops. Each loop is instantiated
+// per kernel, so the rule is looked at once per call instead of once per word.
+struct ConwayKernel {
+    uint64_t operator()(const uint64_t left[3], const uint64_t mid[3], const uint64_t right[3]) const {
+        return stepWord(left, mid, right);
+    }
+};
+
+struct RuleKernel {
+    LifeRule rule; // a copy, which the compiler can keep in registers
+    uint64_t operator()(const uint64_t left[3], const uint64_t mid[3], const uint64_t right[3]) const {
+        return stepWordRule(left, mid, right, rule);
+    }
+};
+
+// Cells outside the board read as dead. Only rows [firstRow, lastRow) of dst are written.
+template <typename Kernel>
+void stepBitBoardRowsWith(const BitBoard& src, BitBoard& dst, int firstRow, int lastRow, Kernel kernel) {
+    const int stride = src.wordsPerRow;
+    const uint64_t lastMask = (src.width & 63) ? (uint64_t(1) << (src.width & 63)) - 1 : ~uint64_t(0);
+
+    auto word = [&](int row, int w) -> uint64_t {
+        if (row < 0 || row >= src.height || w < 0 || w >= stride) return 0;
+        return src.words[row * stride + w];
+    };
+
+    for (int y = firstRow; y < lastRow; ++y) {
+        for (int w = 0; w < stride; ++w) {
+            uint64_t left[3], mid[3], right[3];
+            for (int r = 0; r < 3; ++r) {
+                left[r] = word(y + r - 1, w - 1);
+                mid[r] = word(y + r - 1, w);
+                right[r] = word(y + r - 1, w + 1);
+            }
+
+            uint64_t next = kernel(left, mid, right);
+            if (w == stride - 1) next &= lastMask;
+            dst.words[y * stride + w] = next;
+        }
+    }
+}
+
+void stepBitBoardRows(const BitBoard& src, BitBoard& dst, int firstRow, int lastRow) {
+    if (isConwayRule(rule)) stepBitBoardRowsWith(src, dst, firstRow, lastRow, ConwayKernel());
+    else stepBitBoardRowsWith(src, dst, firstRow, lastRow, RuleKernel{ rule });
+}
+
+void stepBitBoard(const BitBoard& src, BitBoard& dst) {
+    stepBitBoardRows(src, dst, 0, src.height);
+}
+
+int countMismatches(const Board& reference, const BitBoard& bits) {
+    int mismatches = 0;
+    for (int x = 0; x < reference.width; ++x) {
+        for (int y = 0; y < reference.height; ++y) {
+            int bit = (bits.words[y * bits.wordsPerRow + (x >> 6)] >> (x & 63)) & 1;
+            if (bit != reference[x][y]) mismatches++;
+        }
+    }
+    return mismatches;
+}
+
+// HashLife: the universe is a quadtree of canonical (hash-consed) nodes, so
+// identical regions are stored once and the successor of each node is computed
+// once. A node of level k covers 2^k x 2^k cells; its successor is the centre
+// 2^(k-1) square advanced by up to 2^(k-2) generations. Nodes 0 and 1 are the
+// dead and alive leaf cells.
+
+uint64_t hashKey(uint32_t nw, uint32_t ne, uint32_t sw, uint32_t se) {
+    uint64_t h = nw;
+    h = h * 0x9E3779B97F4A7C15ull + ne;
+    h = h * 0x9E3779B97F4A7C15ull + sw;
+    h = h * 0x9E3779B97F4A7C15ull + se;
+    return h ^ (h >> 29);
+}
+
+void rehashNodes(HashLife& life, size_t bucketCount) {
+    life.buckets.assign(bucketCount, NO_NODE);
+    for (uint32_t i = 2; i < life.nodes.size(); ++i) {
+        HashNode& node = life.nodes[i];
+        if (node.level == FREE_LEVEL) continue;
+        size_t b = hashKey(node.nw, node.ne, node.sw, node.se) & (bucketCount - 1);
+        node.next = life.buckets[b];
+        life.buckets[b] = i;
+    }
+}
+
+uint32_t hashJoin(HashLife& life, uint32_t nw, uint32_t ne, uint32_t sw, uint32_t se) {
+    size_t b = hashKey(nw, ne, sw, se) & (life.buckets.size() - 1);
+    for (uint32_t i = life.buckets[b]; i != NO_NODE; i = life.nodes[i].next) {
+        const HashNode& node = life.nodes[i];
+        if (node.nw == nw && node.ne == ne && node.sw == sw && node.se == se) return i;
+    }
+
+    HashNode node;
+    node.nw = nw;
+    node.ne = ne;
+    node.sw = sw;
+    node.se = se;
+    node.level = life.nodes[nw].level + 1;
+    node.population = life.nodes[nw].population + life.nodes[ne].population
+                    + life.nodes[sw].population + life.nodes[se].population;
+    node.next = life.buckets[b];
+
+    uint32_t index;
+    if (!life.freeList.empty()) {
+        index = life.freeList.back();
+        life.freeList.pop_back();
+        life.nodes[index] = node;
+    } else {
+        index = static_cast<uint32_t>(life.nodes.size());
+        life.nodes.push_back(node);
+    }
+    life.buckets[b] = index;
+    life.liveNodes++;
+
+    if (life.liveNodes > life.buckets.size()) {
+        rehashNodes(life, life.buckets.size() * 2);
+    }
+    return index;
+}
+
+uint32_t emptyNode(HashLife& life, int level) {
+    while (static_cast<int>(life.emptyNodes.size()) <= level) {
+        uint32_t e = life.emptyNodes.back();
+        life.emptyNodes.push_back(hashJoin(life, e, e, e, e));
+    }
+    return life.emptyNodes[level];
+}
+
+void initHashLife(HashLife& life, size_t maxNodes) {
+    life = HashLife();
+    life.maxNodes = maxNodes;
+    HashNode dead;
+    HashNode alive;
+    alive.population = 1;
+    life.nodes.push_back(dead);
+    life.nodes.push_back(alive);
+    life.buckets.assign(1 << 16, NO_NODE);
+    life.emptyNodes.push_back(0);
+    life.root = emptyNode(life, 3);
+}
+
+// Level k+1 node with `n` in the middle, so the origin stays at the centre.
+uint32_t expandRoot(HashLife& life, uint32_t n) {
+    const HashNode node = life.nodes[n];
+    uint32_t e = emptyNode(life, node.level - 1);
+    return hashJoin(life,
+        hashJoin(life, e, e, e, node.nw),
+        hashJoin(life, e, e, node.ne, e),
+        hashJoin(life, e, node.sw, e, e),
+        hashJoin(life, node.se, e, e, e));
+}
+
+uint32_t centreNode(HashLife& life, uint32_t n) {
+    const HashNode node = life.nodes[n];
+    return hashJoin(life,
+        life.nodes[node.nw].se, life.nodes[node.ne].sw,
+        life.nodes[node.sw].ne, life.nodes[node.se].nw);
+}
+
+// One generation of the centre 2x2 of a 4x4 node, each cell looked up by its
+// packed 3x3 neighbourhood.
+uint32_t life4x4(HashLife& life, uint32_t n) {
+    const HashNode node = life.nodes[n];
+    const uint32_t quads[4] = { node.nw, node.ne, node.sw, node.se };
+    int cells[4][4];
+    for (int row = 0; row < 4; ++row) {
+        for (int col = 0; col < 4; ++col) {
+            const HashNode& quad = life.nodes[quads[(row >> 1) * 2 + (col >> 1)]];
+            const uint32_t leaves[4] = { quad.nw, quad.ne, quad.sw, quad.se };
+            cells[row][col] = static_cast<int>(leaves[(row & 1) * 2 + (col & 1)]);
+        }
+    }
+
+    uint32_t next[4];
+    for (int row = 1; row <= 2; ++row) {
+        for (int col = 1; col <= 2; ++col) {
+            int bits = 0;
+            for (int dy = -1; dy <= 1; ++dy) {
+                for (int dx = -1; dx <= 1; ++dx) {
+                    bits = bits << 1 | cells[row + dy][col + dx];
+                }
             }
-            glVertex2f(x * CELL_SIZE, y * CELL_SIZE);
-            glVertex2f((x + 1) * CELL_SIZE, y * CELL_SIZE);
-            glVertex2f((x + 1) * CELL_SIZE, (y + 1) * CELL_SIZE);
-            glVertex2f(x * CELL_SIZE, (y + 1) * CELL_SIZE);
+            next[(row - 1) * 2 + (col - 1)] = rule.neighbourhood[bits];
+        }
+    }
+    return hashJoin(life, next[0], next[1], next[2], next[3]);
+}
+
+// Centre of node `n` advanced by 2^j generations (j is clamped to level - 2).
+uint32_t successor(HashLife& life, uint32_t n, int j) {
+    const HashNode node = life.nodes[n]; // copied: hashJoin may grow the vector
+    if (node.population == 0) return node.nw;
+    j = std::min(j, node.level - 2);
+    if (node.result != NO_NODE && node.resultStep == j) return node.result;
+
+    uint32_t result;
+    if (node.level == 2) {
+        result = life4x4(life, n);
+    } else {
+        const HashNode a = life.nodes[node.nw];
+        const HashNode b = life.nodes[node.ne];
+        const HashNode c = life.nodes[node.sw];
+        const HashNode d = life.nodes[node.se];
+
+        // The nine overlapping half-size squares of this node, advanced.
+        uint32_t s[9];
+        s[0] = successor(life, node.nw, j);
+        s[1] = successor(life, hashJoin(life, a.ne, b.nw, a.se, b.sw), j);
+        s[2] = successor(life, node.ne, j);
+        s[3] = successor(life, hashJoin(life, a.sw, a.se, c.nw, c.ne), j);
+        s[4] = successor(life, hashJoin(life, a.se, b.sw, c.ne, d.nw), j);
+        s[5] = successor(life, hashJoin(life, b.sw, b.se, d.nw, d.ne), j);
+        s[6] = successor(life, node.sw, j);
+        s[7] = successor(life, hashJoin(life, c.ne, d.nw, c.se, d.sw), j);
+        s[8] = successor(life, node.se, j);
+
+        if (j < node.level - 2) {
+            // Already advanced far enough; stitch the centre from the pieces.
+            HashNode p[9];
+            for (int i = 0; i < 9; ++i) p[i] = life.nodes[s[i]];
+            uint32_t nw = hashJoin(life, p[0].se, p[1].sw, p[3].ne, p[4].nw);
+            uint32_t ne = hashJoin(life, p[1].se, p[2].sw, p[4].ne, p[5].nw);
+            uint32_t sw = hashJoin(life, p[3].se, p[4].sw, p[6].ne, p[7].nw);
+            uint32_t se = hashJoin(life, p[4].se, p[5].sw, p[7].ne, p[8].nw);
+            result = hashJoin(life, nw, ne, sw, se);
+        } else {
+            // Advance a second time, for 2^(level-2) generations in total.
+            uint32_t nw = successor(life, hashJoin(life, s[0], s[1], s[3], s[4]), j);
+            uint32_t ne = successor(life, hashJoin(life, s[1], s[2], s[4], s[5]), j);
+            uint32_t sw = successor(life, hashJoin(life, s[3], s[4], s[6], s[7]), j);
+            uint32_t se = successor(life, hashJoin(life, s[4], s[5], s[7], s[8]), j);
+            result = hashJoin(life, nw, ne, sw, se);
+        }
+    }
+
+    life.nodes[n].result = result;
+    life.nodes[n].resultStep = static_cast<int8_t>(j);
+    return result;
+}
+
+void markNode(HashLife& life, uint32_t n) {
+    HashNode& node = life.nodes[n];
+    if (node.marked || node.level == 0) return;
+    node.marked = true;
+    markNode(life, node.nw);
+    markNode(life, node.ne);
+    markNode(life, node.sw);
+    markNode(life, node.se);
+}
+
+// Frees every node not reachable from the root. Memoized results are kept only
+// when they point at surviving nodes.
+void collectGarbage(HashLife& life) {
+    markNode(life, life.root);
+    for (uint32_t e : life.emptyNodes) markNode(life, e);
+
+    life.freeList.clear();
+    life.liveNodes = 0;
+    for (uint32_t i = 2; i < life.nodes.size(); ++i) {
+        HashNode& node = life.nodes[i];
+        if (node.level == FREE_LEVEL) {
+            life.freeList.push_back(i);
+        } else if (!node.marked) {
+            node.level = FREE_LEVEL;
+            life.freeList.push_back(i);
+        } else {
+            life.liveNodes++;
+        }
+    }
+    for (uint32_t i = 2; i < life.nodes.size(); ++i) {
+        HashNode& node = life.nodes[i];
+        if (node.level == FREE_LEVEL) continue;
+        node.marked = false;
+        if (node.result != NO_NODE && life.nodes[node.result].level == FREE_LEVEL) {
+            node.result = NO_NODE;
+        }
+    }
+    rehashNodes(life, life.buckets.size());
+}
+
+// Advances the universe by 2^stepLog generations. The root is first padded
+// until the pattern sits in its centre quarter, so nothing can escape the
+// region the successor covers. The node cap is soft: it is enforced between
+// steps, since a step's intermediate nodes are not reachable from the root.
+void advanceHashLife(HashLife& life, int stepLog) {
+    if (life.liveNodes > life.maxNodes) collectGarbage(life);
+
+    while (life.nodes[life.root].level < stepLog + 3 ||
+           life.nodes[centreNode(life, centreNode(life, life.root))].population != life.nodes[life.root].population) {
+        life.root = expandRoot(life, life.root);
+    }
+    uint32_t next = successor(life, life.root, stepLog);
+    life.root = expandRoot(life, next);
+    life.generation += uint64_t(1) << stepLog;
+}
+
+uint32_t setCell(HashLife& life, uint32_t n, int64_t x, int64_t y, bool alive) {
+    const HashNode node = life.nodes[n];
+    if (node.level == 0) return alive ? 1 : 0;
+
+    int64_t half = int64_t(1) << (node.level - 1);
+    uint32_t nw = node.nw, ne = node.ne, sw = node.sw, se = node.se;
+    if (y < half) {
+        if (x < half) nw = setCell(life, nw, x, y, alive);
+        else ne = setCell(life, ne, x - half, y, alive);
+    } else {
+        if (x < half) sw = setCell(life, sw, x, y - half, alive);
+        else se = setCell(life, se, x - half, y - half, alive);
+    }
+    return hashJoin(life, nw, ne, sw, se);
+}
+
+// Sets a cell in board coordinates, growing the universe as needed.
+void setHashLifeCell(HashLife& life, int64_t x, int64_t y, bool alive) {
+    while (true) {
+        int64_t half = int64_t(1) << (life.nodes[life.root].level - 1);
+        if (x >= -half && x < half && y >= -half && y < half) {
+            life.root = setCell(life, life.root, x + half, y + half, alive);
+            return;
         }
+        life.root = expandRoot(life, life.root);
     }
-    glEnd();
+}
+
+void fillViewport(const HashLife& life, uint32_t n, int64_t originX, int64_t originY,
+                  int64_t viewX, int64_t viewY, Board& game) {
+    const HashNode& node = life.nodes[n];
+    int64_t size = int64_t(1) << node.level;
+    if (node.population == 0 ||
+        originX >= viewX + game.width || originX + size <= viewX ||
+        originY >= viewY + game.height || originY + size <= viewY) {
+        return;
+    }
+    if (node.level == 0) {
+        game[originX - viewX][originY - viewY] = 1;
+        return;
+    }
+    int64_t half = size / 2;
+    fillViewport(life, node.nw, originX, originY, viewX, viewY, game);
+    fillViewport(life, node.ne, originX + half, originY, viewX, viewY, game);
+    fillViewport(life, node.sw, originX, originY + half, viewX, viewY, game);
+    fillViewport(life, node.se, originX + half, originY + half, viewX, viewY, game);
+}
+
+// Copies the cells of the window-sized viewport at (viewX, viewY) into `game`.
+void renderViewport(const HashLife& life, int64_t viewX, int64_t viewY, Board& game) {
+    clearBoard(game);
+    int64_t half = int64_t(1) << (life.nodes[life.root].level - 1);
+    fillViewport(life, life.root, -half, -half, viewX, viewY, game);
+}
+
+// Writes the viewport (including cleared cells) back into the universe.
+void storeViewport(HashLife& life, int64_t viewX, int64_t viewY, const Board& game) {
+    for (int x = 0; x < game.width; ++x) {
+        for (int y = 0; y < game.height; ++y) {
+            setHashLifeCell(life, viewX + x, viewY + y, game[x][y] == 1);
+        }
+    }
+}
+
+uint64_t tileKey(int32_t tileX, int32_t tileY) {
+    return (static_cast<uint64_t>(static_cast<uint32_t>(tileX)) << 32) | static_cast<uint32_t>(tileY);
+}
+
+int32_t tileKeyX(uint64_t key) { return static_cast<int32_t>(key >> 32); }
+int32_t tileKeyY(uint64_t key) { return static_cast<int32_t>(key & 0xffffffffu); }
+
+Tile* findTile(TiledBoard& board, int32_t tileX, int32_t tileY) {
+    auto it = board.tiles.find(tileKey(tileX, tileY));
+    return it == board.tiles.end() ? nullptr : &it->second;
+}
+
+// Floor division, so negative cells map to the tile on their left / above.
+int32_t tileCoord(int64_t cell) {
+    return static_cast<int32_t>(cell >= 0 ? cell / TILE_SIZE : (cell - TILE_SIZE + 1) / TILE_SIZE);
+}
+
+// Clearing a cell never creates its tile, so storing a mostly dead viewport
+// only allocates tiles that hold live cells.
+void setTiledCell(TiledBoard& board, int64_t x, int64_t y, bool alive) {
+    int32_t tileX = tileCoord(x);
+    int32_t tileY = tileCoord(y);
+    if (!alive && !findTile(board, tileX, tileY)) return;
+    Tile& tile = board.tiles[tileKey(tileX, tileY)];
+    int cellX = static_cast<int>(x - int64_t(tileX) * TILE_SIZE);
+    int cellY = static_cast<int>(y - int64_t(tileY) * TILE_SIZE);
+    uint64_t bit = uint64_t(1) << cellX;
+    uint64_t row = alive ? (tile.rows[cellY] | bit) : (tile.rows[cellY] & ~bit);
+    if (row != tile.rows[cellY]) {
+        tile.rows[cellY] = row;
+        board.active.push_back(tileKey(tileX, tileY));
+    }
+}
+
+// Computes the next rows of every scheduled tile, reading missing neighbours as
+// dead, and marks which tiles changed.
+template <typename Kernel>
+void stepScheduledTiles(TiledBoard& board, Kernel kernel) {
+    static const uint64_t emptyRows[TILE_SIZE] = {};
+    for (uint64_t key : board.scheduled) {
+        int32_t tileX = tileKeyX(key);
+        int32_t tileY = tileKeyY(key);
+
+        const uint64_t* around[3][3];
+        for (int dy = -1; dy <= 1; ++dy) {
+            for (int dx = -1; dx <= 1; ++dx) {
+                Tile* neighbor = findTile(board, tileX + dx, tileY + dy);
+                around[dy + 1][dx + 1] = neighbor ? neighbor->rows : emptyRows;
+            }
+        }
+
+        Tile& tile = board.tiles[key];
+        bool changed = false;
+        for (int y = 0; y < TILE_SIZE; ++y) {
+            uint64_t left[3], mid[3], right[3];
+            for (int r = 0; r < 3; ++r) {
+                int row = y + r - 1;
+                int band = row < 0 ? 0 : (row >= TILE_SIZE ? 2 : 1);
+                row = (row + TILE_SIZE) % TILE_SIZE;
+                left[r] = around[band][0][row];
+                mid[r] = around[band][1][row];
+                right[r] = around[band][2][row];
+            }
+            tile.next[y] = kernel(left, mid, right);
+            changed |= tile.next[y] != tile.rows[y];
+        }
+        tile.changed = changed;
+    }
+}
+
+// Steps only tiles that changed last generation and their neighbours. A missing
+// neighbour is created only when live cells touch the shared edge or corner,
+// and tiles that end up empty and unchanged are freed.
+void stepTiledBoard(TiledBoard& board) {
+    const uint64_t stamp = ++board.generation;
+    board.scheduled.clear();
+
+    auto schedule = [&](int32_t tileX, int32_t tileY, bool create) {
+        uint64_t key = tileKey(tileX, tileY);
+        auto it = board.tiles.find(key);
+        if (it == board.tiles.end()) {
+            if (!create) return;
+            it = board.tiles.emplace(key, Tile()).first;
+        }
+        if (it->second.scheduledAt == stamp) return;
+        it->second.scheduledAt = stamp;
+        board.scheduled.push_back(key);
+    };
+
+    for (uint64_t key : board.active) {
+        int32_t tileX = tileKeyX(key);
+        int32_t tileY = tileKeyY(key);
+        Tile* tile = findTile(board, tileX, tileY);
+        if (!tile) continue;
+
+        uint64_t westColumn = 0, eastColumn = 0;
+        for (int y = 0; y < TILE_SIZE; ++y) {
+            westColumn |= tile->rows[y] & 1;
+            eastColumn |= tile->rows[y] >> 63;
+        }
+        const uint64_t northRow = tile->rows[0];
+        const uint64_t southRow = tile->rows[TILE_SIZE - 1];
+
+        for (int dy = -1; dy <= 1; ++dy) {
+            for (int dx = -1; dx <= 1; ++dx) {
+                bool touches;
+                if (dx == 0 && dy == 0) {
+                    touches = true;
+                } else if (dx == 0) {
+                    touches = (dy < 0 ? northRow : southRow) != 0;
+                } else if (dy == 0) {
+                    touches = (dx < 0 ? westColumn : eastColumn) != 0;
+                } else {
+                    uint64_t edge = dy < 0 ? northRow : southRow;
+                    touches = ((edge >> (dx < 0 ? 0 : 63)) & 1) != 0;
+                }
+                schedule(tileX + dx, tileY + dy, touches);
+            }
+        }
+    }
+
+    if (isConwayRule(rule)) stepScheduledTiles(board, ConwayKernel());
+    else stepScheduledTiles(board, RuleKernel{ rule });
+
+    board.active.clear();
+    for (uint64_t key : board.scheduled) {
+        Tile& tile = board.tiles[key];
+        uint64_t any = 0;
+        for (int y = 0; y < TILE_SIZE; ++y) {
+            tile.rows[y] = tile.next[y];
+            any |= tile.rows[y];
+        }
+        if (tile.changed) {
+            board.active.push_back(key);
+        } else if (any == 0) {
+            board.tiles.erase(key);
+        }
+    }
+}
+
+void renderTiledViewport(TiledBoard& board, int64_t viewX, int64_t viewY, Board& game) {
+    clearBoard(game);
+    for (int32_t tileY = tileCoord(viewY); tileY <= tileCoord(viewY + game.height - 1); ++tileY) {
+        for (int32_t tileX = tileCoord(viewX); tileX <= tileCoord(viewX + game.width - 1); ++tileX) {
+            Tile* tile = findTile(board, tileX, tileY);
+            if (!tile) continue;
+            for (int y = 0; y < TILE_SIZE; ++y) {
+                int64_t gameY = int64_t(tileY) * TILE_SIZE + y - viewY;
+                if (gameY < 0 || gameY >= game.height || tile->rows[y] == 0) continue;
+                for (int x = 0; x < TILE_SIZE; ++x) {
+                    int64_t gameX = int64_t(tileX) * TILE_SIZE + x - viewX;
+                    if (gameX < 0 || gameX >= game.width) continue;
+                    game[gameX][gameY] = (tile->rows[y] >> x) & 1;
+                }
+            }
+        }
+    }
+}
+
+void storeTiledViewport(TiledBoard& board, int64_t viewX, int64_t viewY, const Board& game) {
+    for (int x = 0; x < game.width; ++x) {
+        for (int y = 0; y < game.height; ++y) {
+            setTiledCell(board, viewX + x, viewY + y, game[x][y] == 1);
+        }
+    }
+}
+
+// Sets a run of live cells along row y without scheduling the tiles it
+// touches; callers mark them active once the whole pattern is in. The tile
+// last written is cached, since consecutive runs mostly share one.
+struct TileRunWriter {
+    TiledBoard* board = nullptr;
+    uint64_t key = 0;
+    Tile* tile = nullptr;
+};
+
+void setTiledRun(TileRunWriter& writer, int64_t x, int64_t y, int64_t length) {
+    const int32_t tileY = tileCoord(y);
+    const int cellY = static_cast<int>(y - int64_t(tileY) * TILE_SIZE);
+    while (length > 0) {
+        const int32_t tileX = tileCoord(x);
+        const int cellX = static_cast<int>(x - int64_t(tileX) * TILE_SIZE);
+        const int count = static_cast<int>(std::min<int64_t>(length, TILE_SIZE - cellX));
+        const uint64_t key = tileKey(tileX, tileY);
+        if (!writer.tile || writer.key != key) {
+            writer.tile = &writer.board->tiles[key];
+            writer.key = key;
+        }
+        uint64_t bits = count == 64 ? ~uint64_t(0) : (uint64_t(1) << count) - 1;
+        writer.tile->rows[cellY] |= bits << cellX;
+        x += count;
+        length -= count;
+    }
+}
+
+void activateAllTiles(TiledBoard& board) {
+    board.active.clear();
+    for (const auto& entry : board.tiles) board.active.push_back(entry.first);
+}
+
+// The level-`level` node for the square of a tile's rows at (x, y).
+uint32_t tileNode(HashLife& life, const uint64_t* rows, int x, int y, int level) {
+    if (level == 0) return (rows[y] >> x) & 1;
+    const int size = 1 << level;
+    const uint64_t mask = size == 64 ? ~uint64_t(0) : ((uint64_t(1) << size) - 1) << x;
+    uint64_t any = 0;
+    for (int row = y; row < y + size; ++row) any |= rows[row] & mask;
+    if (any == 0) return emptyNode(life, level);
+    const int half = size / 2;
+    return hashJoin(life,
+        tileNode(life, rows, x, y, level - 1), tileNode(life, rows, x + half, y, level - 1),
+        tileNode(life, rows, x, y + half, level - 1), tileNode(life, rows, x + half, y + half, level - 1));
+}
+
+// Union of the live cells of two nodes of the same level.
+uint32_t mergeNodes(HashLife& life, uint32_t a, uint32_t b) {
+    const HashNode na = life.nodes[a];
+    const HashNode nb = life.nodes[b];
+    if (nb.population == 0) return a;
+    if (na.population == 0 || a == b) return b;
+    if (na.level == 0) return 1;
+    return hashJoin(life,
+        mergeNodes(life, na.nw, nb.nw), mergeNodes(life, na.ne, nb.ne),
+        mergeNodes(life, na.sw, nb.sw), mergeNodes(life, na.se, nb.se));
+}
+
+uint32_t insertNode(HashLife& life, uint32_t n, int64_t x, int64_t y, uint32_t piece) {
+    const HashNode node = life.nodes[n];
+    if (node.level == life.nodes[piece].level) return mergeNodes(life, n, piece);
+
+    int64_t half = int64_t(1) << (node.level - 1);
+    uint32_t nw = node.nw, ne = node.ne, sw = node.sw, se = node.se;
+    if (y < half) {
+        if (x < half) nw = insertNode(life, nw, x, y, piece);
+        else ne = insertNode(life, ne, x - half, y, piece);
+    } else {
+        if (x < half) sw = insertNode(life, sw, x, y - half, piece);
+        else se = insertNode(life, se, x - half, y - half, piece);
+    }
+    return hashJoin(life, nw, ne, sw, se);
+}
+
+// Adds the live cells of every tile to the universe, a whole tile (one level-6
+// node) at a time rather than cell by cell.
+void storeTiles(HashLife& life, const TiledBoard& board) {
+    for (const auto& entry : board.tiles) {
+        const int64_t x = int64_t(tileKeyX(entry.first)) * TILE_SIZE;
+        const int64_t y = int64_t(tileKeyY(entry.first)) * TILE_SIZE;
+        uint32_t piece = tileNode(life, entry.second.rows, 0, 0, 6);
+        if (life.nodes[piece].population == 0) continue;
+        while (true) {
+            // Level 7 and up, the root's quadrants line up with the tile grid.
+            int64_t half = int64_t(1) << (life.nodes[life.root].level - 1);
+            if (half >= TILE_SIZE && x >= -half && x + TILE_SIZE <= half && y >= -half && y + TILE_SIZE <= half) {
+                life.root = insertNode(life, life.root, x + half, y + half, piece);
+                break;
+            }
+            life.root = expandRoot(life, life.root);
+        }
+    }
+    if (life.liveNodes > life.maxNodes) collectGarbage(life);
+}
+
+void fillTileRows(const HashLife& life, uint32_t n, int x, int y, uint64_t* rows) {
+    const HashNode& node = life.nodes[n];
+    if (node.population == 0) return;
+    if (node.level == 0) {
+        rows[y] |= uint64_t(1) << x;
+        return;
+    }
+    int half = 1 << (node.level - 1);
+    fillTileRows(life, node.nw, x, y, rows);
+    fillTileRows(life, node.ne, x + half, y, rows);
+    fillTileRows(life, node.sw, x, y + half, rows);
+    fillTileRows(life, node.se, x + half, y + half, rows);
+}
+
+// Copies the live cells of node `n`, whose top-left cell is (originX, originY), into tiles.
+void collectTiles(const HashLife& life, uint32_t n, int64_t originX, int64_t originY, TiledBoard& board) {
+    const HashNode& node = life.nodes[n];
+    if (node.population == 0) return;
+    if (node.level == 0) {
+        setTiledCell(board, originX, originY, true);
+        return;
+    }
+    if (node.level == 6 && originX % TILE_SIZE == 0 && originY % TILE_SIZE == 0) {
+        fillTileRows(life, n, 0, 0, board.tiles[tileKey(tileCoord(originX), tileCoord(originY))].rows);
+        return;
+    }
+    int64_t half = int64_t(1) << (node.level - 1);
+    collectTiles(life, node.nw, originX, originY, board);
+    collectTiles(life, node.ne, originX + half, originY, board);
+    collectTiles(life, node.sw, originX, originY + half, board);
+    collectTiles(life, node.se, originX + half, originY + half, board);
+}
+
+void hashLifeTiles(const HashLife& life, TiledBoard& board) {
+    int64_t half = int64_t(1) << (life.nodes[life.root].level - 1);
+    collectTiles(life, life.root, -half, -half, board);
+}
+
+void boardTiles(const Board& game, TiledBoard& board) {
+    for (int x = 0; x < game.width; ++x) {
+        for (int y = 0; y < game.height; ++y) {
+            if (game[x][y] == 1) setTiledCell(board, x, y, true);
+        }
+    }
+}
+
+// Streams a pattern file into `game` with its origin at (originX, originY);
+// cells outside the board are dropped.
+bool importPatternBoard(const char* path, int64_t originX, int64_t originY, Board& game, PatternInfo& info) {
+    auto addRun = [&](int64_t x, int64_t y, int64_t length) {
+        int64_t row = originY + y;
+        if (row < 0 || row >= game.height) return;
+        int64_t first = std::max<int64_t>(originX + x, 0);
+        int64_t last = std::min<int64_t>(originX + x + length, game.width);
+        for (int64_t column = first; column < last; ++column) game[column][row] = 1;
+    };
+    if (!readPattern(path, addRun, info)) return false;
+    boardEdited = true;
+    return true;
+}
+
+// Streams a pattern file into the tiled board with its origin at (originX, originY).
+bool importPatternTiles(const char* path, int64_t originX, int64_t originY, TiledBoard& board, PatternInfo& info) {
+    TileRunWriter writer;
+    writer.board = &board;
+    auto addRun = [&](int64_t x, int64_t y, int64_t length) {
+        setTiledRun(writer, originX + x, originY + y, length);
+    };
+    bool ok = readPattern(path, addRun, info);
+    activateAllTiles(board);
+    return ok;
+}
+
+// Writes the live cells of the tiled board, row by row within each band of
+// tiles, as a pattern file cropped to their bounding box.
+bool exportPattern(const char* path, const TiledBoard& board) {
+    std::vector<uint64_t> keys;
+    int64_t minX = 0, minY = 0, maxX = -1, maxY = -1;
+    for (const auto& entry : board.tiles) {
+        const Tile& tile = entry.second;
+        uint64_t columns = 0;
+        int firstRow = -1, lastRow = -1;
+        for (int y = 0; y < TILE_SIZE; ++y) {
+            if (tile.rows[y] == 0) continue;
+            columns |= tile.rows[y];
+            if (firstRow < 0) firstRow = y;
+            lastRow = y;
+        }
+        if (columns == 0) continue;
+        keys.push_back(entry.first);
+        int64_t tileX = int64_t(tileKeyX(entry.first)) * TILE_SIZE;
+        int64_t tileY = int64_t(tileKeyY(entry.first)) * TILE_SIZE;
+        int64_t left = tileX + __builtin_ctzll(columns);
+        int64_t right = tileX + 63 - __builtin_clzll(columns);
+        bool first = maxX < minX;
+        minX = first ? left : std::min(minX, left);
+        maxX = first ? right : std::max(maxX, right);
+        minY = first ? tileY + firstRow : std::min(minY, tileY + firstRow);
+        maxY = first ? tileY + lastRow : std::max(maxY, tileY + lastRow);
+    }
+    std::sort(keys.begin(), keys.end(), [](uint64_t a, uint64_t b) {
+        return tileKeyY(a) != tileKeyY(b) ? tileKeyY(a) < tileKeyY(b) : tileKeyX(a) < tileKeyX(b);
+    });
+
+    PatternWriter out;
+    if (!beginPatternWrite(out, path, patternFormatForPath(path), lifeRuleName(rule),
+                           minX, minY, maxX - minX + 1, maxY - minY + 1)) {
+        return false;
+    }
+    for (size_t band = 0; band < keys.size();) {
+        size_t bandEnd = band;
+        while (bandEnd < keys.size() && tileKeyY(keys[bandEnd]) == tileKeyY(keys[band])) ++bandEnd;
+        for (int y = 0; y < TILE_SIZE; ++y) {
+            for (size_t k = band; k < bandEnd; ++k) {
+                uint64_t word = board.tiles.at(keys[k]).rows[y];
+                while (word != 0) {
+                    int start = __builtin_ctzll(word);
+                    uint64_t rest = ~(word >> start);
+                    int length = rest == 0 ? 64 - start : __builtin_ctzll(rest);
+                    writeRun(out, int64_t(tileKeyX(keys[k])) * TILE_SIZE + start,
+                             int64_t(tileKeyY(keys[k])) * TILE_SIZE + y, length);
+                    word &= length == 64 ? 0 : ~(((uint64_t(1) << length) - 1) << start);
+                }
+            }
+        }
+        band = bandEnd;
+    }
+    return finishPatternWrite(out, path);
+}
+
+// ORs the 64 cells of `word` into a packed row starting at column `offset`,
+// which may be negative or past the end; cells outside the row are dropped.
+inline void orRowBits(uint64_t* row, int wordsPerRow, int64_t offset, uint64_t word) {
+    if (offset <= -64 || offset >= int64_t(wordsPerRow) * 64) return;
+    if (offset < 0) {
+        row[0] |= word >> -offset;
+        return;
+    }
+    int w = static_cast<int>(offset >> 6);
+    int shift = static_cast<int>(offset & 63);
+    row[w] |= word << shift;
+    if (shift != 0 && w + 1 < wordsPerRow) row[w + 1] |= word >> (64 - shift);
+}
+
+void clearPadding(BitBoard& bits) {
+    if ((bits.width & 63) == 0) return;
+    const uint64_t lastMask = (uint64_t(1) << (bits.width & 63)) - 1;
+    for (int y = 0; y < bits.height; ++y) bits.words[y * bits.wordsPerRow + bits.wordsPerRow - 1] &= lastMask;
+}
+
+// Packs the cells of the tiled board from (x, y) into `frame`, a whole tile row
+// at a time.
+void renderTiledRegion(TiledBoard& board, int64_t x, int64_t y, BitBoard& frame) {
+    std::fill(frame.words.begin(), frame.words.end(), 0);
+    for (int32_t tileY = tileCoord(y); tileY <= tileCoord(y + frame.height - 1); ++tileY) {
+        for (int32_t tileX = tileCoord(x); tileX <= tileCoord(x + frame.width - 1); ++tileX) {
+            Tile* tile = findTile(board, tileX, tileY);
+            if (!tile) continue;
+            for (int row = 0; row < TILE_SIZE; ++row) {
+                int64_t frameY = int64_t(tileY) * TILE_SIZE + row - y;
+                if (frameY < 0 || frameY >= frame.height || tile->rows[row] == 0) continue;
+                orRowBits(&frame.words[frameY * frame.wordsPerRow], frame.wordsPerRow,
+                          int64_t(tileX) * TILE_SIZE - x, tile->rows[row]);
+            }
+        }
+    }
+    clearPadding(frame);
+}
+
+void fillRegion(const HashLife& life, uint32_t n, int64_t originX, int64_t originY,
+                int64_t x, int64_t y, BitBoard& frame) {
+    const HashNode& node = life.nodes[n];
+    int64_t size = int64_t(1) << node.level;
+    if (node.population == 0 ||
+        originX >= x + frame.width || originX + size <= x ||
+        originY >= y + frame.height || originY + size <= y) {
+        return;
+    }
+    if (node.level <= 6) {
+        uint64_t rows[TILE_SIZE] = {};
+        fillTileRows(life, n, 0, 0, rows);
+        for (int row = 0; row < size; ++row) {
+            int64_t frameY = originY + row - y;
+            if (frameY < 0 || frameY >= frame.height || rows[row] == 0) continue;
+            orRowBits(&frame.words[frameY * frame.wordsPerRow], frame.wordsPerRow, originX - x, rows[row]);
+        }
+        return;
+    }
+    int64_t half = size / 2;
+    fillRegion(life, node.nw, originX, originY, x, y, frame);
+    fillRegion(life, node.ne, originX + half, originY, x, y, frame);
+    fillRegion(life, node.sw, originX, originY + half, x, y, frame);
+    fillRegion(life, node.se, originX + half, originY + half, x, y, frame);
+}
+
+// Packs the cells of the universe from (x, y) into `frame`.
+void renderHashLifeRegion(const HashLife& life, int64_t x, int64_t y, BitBoard& frame) {
+    std::fill(frame.words.begin(), frame.words.end(), 0);
+    int64_t half = int64_t(1) << (life.nodes[life.root].level - 1);
+    fillRegion(life, life.root, -half, -half, x, y, frame);
+    clearPadding(frame);
+}
+
+// Zooms by `factor` about window pixel (pivotX, pivotY), keeping the cell
+// under it in place.
+void zoomView(GridView& view, double factor, double pivotX, double pivotY) {
+    double cellPixels = std::max(MIN_CELL_PIXELS, std::min(view.cellPixels * factor, MAX_CELL_PIXELS));
+    view.originX += pivotX / view.cellPixels - pivotX / cellPixels;
+    view.originY += pivotY / view.cellPixels - pivotY / cellPixels;
+    view.cellPixels = cellPixels;
 }
 
 void setupOpenGL(int width, int height) {
@@ -66,10 +1205,105 @@ void setupOpenGL(int width, int height) {
     glLoadIdentity();
 }
 
-void placePattern(std::array<std::array<int, GAME_HEIGHT>, GAME_WIDTH>& game, int cellX, int cellY) {
-    if (cellX >= 0 && cellX < GAME_WIDTH && cellY >= 0 && cellY < GAME_HEIGHT) {
+void placePattern(Board& game, int cellX, int cellY) {
+    if (cellX >= 0 && cellX < game.width && cellY >= 0 && cellY < game.height) {
         game[cellX][cellY] = 1; // Toggle cell state
+        boardEdited = true;
+        recordInput(editRecorder, generation, static_cast<float>(cellX), static_cast<float>(cellY), 1);
+    }
+}
+
+// Places the recorded edits made before the current generation.
+void replayEdits(Board& game) {
+    InputEvent event;
+    while (nextInput(editReplay, generation, event)) {
+        placePattern(game, static_cast<int>(event.x), static_cast<int>(event.y));
+    }
+}
+
+// The board is stored one bit per cell, and the rule's name in section 1.
+// Generations rules also store every cell's state, one byte per cell in row
+// order, in section 2. HashLife and the tiled board save the visible viewport.
+bool writeLifeSnapshot(const char* path, const Board& game, int startGeneration, const std::vector<InputEvent>& edits) {
+    BitBoard bits = makeBitBoard(game.width, game.height);
+    packBoard(game, bits);
+    const std::string ruleName = lifeRuleName(rule);
+    std::vector<uint8_t> states;
+    if (rule.states > 2) {
+        states.resize(static_cast<size_t>(game.width) * game.height);
+        for (int y = 0; y < game.height; ++y) {
+            for (int x = 0; x < game.width; ++x) {
+                states[static_cast<size_t>(y) * game.width + x] = static_cast<uint8_t>(game[x][y]);
+            }
+        }
     }
+    SnapshotHeader header;
+    header.kind = SNAPSHOT_LIFE;
+    header.count = game.width;
+    header.height = game.height;
+    header.step = startGeneration;
+    SnapshotSection sections[SNAPSHOT_SECTIONS];
+    sections[0] = { bits.words.data(), bits.words.size() * sizeof(uint64_t) };
+    sections[1] = { ruleName.data(), ruleName.size() };
+    sections[2] = { states.data(), states.size() };
+    sections[SNAPSHOT_INPUT_SECTION] = { edits.data(), edits.size() * sizeof(InputEvent) };
+    return writeSnapshot(path, header, sections);
+}
+
+// Runs the snapshot under the rule it was recorded with; an explicit --rule
+// (`ruleGiven`) must name the same one.
+bool loadLifeSnapshot(const char* path, Board& game, bool ruleGiven) {
+    if (!mapSnapshot(path, SNAPSHOT_LIFE, loadedSnapshot)) return false;
+    const SnapshotHeader& header = *loadedSnapshot.header;
+    BitBoard bits = makeBitBoard(game.width, game.height);
+    if (header.count != static_cast<uint64_t>(game.width) || header.height != static_cast<uint64_t>(game.height) ||
+        snapshotCount<uint64_t>(loadedSnapshot, 0) != bits.words.size()) {
+        std::cerr << "Snapshot " << path << " is a " << header.count << "x" << header.height
+                  << " board, expected " << game.width << "x" << game.height
+                  << " (set the size with --board-size)" << std::endl;
+        return false;
+    }
+
+    // Version 1 snapshots from before the rule was saved are all B3/S23.
+    std::string ruleName = "B3/S23";
+    if (snapshotCount<char>(loadedSnapshot, 1) > 0) {
+        ruleName.assign(snapshotSection<char>(loadedSnapshot, 1), snapshotCount<char>(loadedSnapshot, 1));
+    } else if (header.version >= 2) {
+        std::cerr << "Snapshot " << path << " does not name its rule" << std::endl;
+        return false;
+    }
+    LifeRule recorded;
+    if (!parseLifeRule(ruleName, recorded)) {
+        std::cerr << "Snapshot " << path << " has unknown rule " << ruleName << std::endl;
+        return false;
+    }
+    if (ruleGiven && lifeRuleName(recorded) != lifeRuleName(rule)) {
+        std::cerr << "Snapshot " << path << " was recorded with rule " << lifeRuleName(recorded)
+                  << ", not " << lifeRuleName(rule) << std::endl;
+        return false;
+    }
+    rule = recorded;
+
+    if (rule.states > 2) {
+        const size_t cells = static_cast<size_t>(game.width) * game.height;
+        const uint8_t* states = snapshotSection<uint8_t>(loadedSnapshot, 2);
+        if (snapshotCount<uint8_t>(loadedSnapshot, 2) != cells ||
+            std::any_of(states, states + cells, [](uint8_t state) { return state >= rule.states; })) {
+            std::cerr << "Snapshot " << path << " does not hold valid cell states for rule "
+                      << lifeRuleName(rule) << std::endl;
+            return false;
+        }
+        for (int y = 0; y < game.height; ++y) {
+            for (int x = 0; x < game.width; ++x) game[x][y] = states[static_cast<size_t>(y) * game.width + x];
+        }
+    } else {
+        std::memcpy(bits.words.data(), snapshotSection<uint64_t>(loadedSnapshot, 0), bits.words.size() * sizeof(uint64_t));
+        unpackBoard(bits, game);
+    }
+    boardEdited = true;
+    generation = static_cast<int>(header.step);
+    editReplay = snapshotInput(loadedSnapshot);
+    return true;
 }
 
 void mouseButtonCallback(GLFWwindow* window, int button, int action, int mods) {
@@ -86,26 +1320,347 @@ void mouseButtonCallback(GLFWwindow* window, int button, int action, int mods) {
 
 void cursorPosCallback(GLFWwindow* window, double xpos, double ypos) {
     static bool isDragging = false;
+    if (!pipelined && replayActive(editReplay)) return;
 
     int state = glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT);
     if (state == GLFW_PRESS) {
-        int cellX = static_cast<int>(xpos) / CELL_SIZE;
-        int cellY = static_cast<int>(ypos) / CELL_SIZE;
+        int64_t boardX = static_cast<int64_t>(std::floor(gridView.originX + xpos / gridView.cellPixels));
+        int64_t boardY = static_cast<int64_t>(std::floor(gridView.originY + ypos / gridView.cellPixels));
+        if (pipelined) {
+            // The simulation thread owns the board, and checks for a replay.
+            LifeMessage message;
+            message.x = boardX;
+            message.y = boardY;
+            push(lifeMessages, message);
+            return;
+        }
+        int64_t cellX = boardX - gridView.boardX;
+        int64_t cellY = boardY - gridView.boardY;
 
-        if (cellX >= 0 && cellX < GAME_WIDTH && cellY >= 0 && cellY < GAME_HEIGHT) {
-            std::array<std::array<int, GAME_HEIGHT>, GAME_WIDTH>* displayPtr = static_cast<std::array<std::array<int, GAME_HEIGHT>, GAME_WIDTH>*>(glfwGetWindowUserPointer(window));
-            placePattern(*displayPtr, cellX, cellY);
+        Board* displayPtr = static_cast<Board*>(glfwGetWindowUserPointer(window));
+        if (cellX >= 0 && cellX < displayPtr->width && cellY >= 0 && cellY < displayPtr->height) {
+            placePattern(*displayPtr, static_cast<int>(cellX), static_cast<int>(cellY));
         }
     }
 }
 
-int main() {
+void scrollCallback(GLFWwindow* window, double, double yoffset) {
+    double xpos, ypos;
+    glfwGetCursorPos(window, &xpos, &ypos);
+    zoomView(gridView, std::pow(1.25, yoffset), xpos, ypos);
+}
+
+int main(int argc, char** argv) {
+    Engine engine = Engine::Scalar;
+    int threadCount = std::max(1u, std::thread::hardware_concurrency());
+    // Time between generations; zero steps as fast as possible.
+    std::chrono::nanoseconds stepInterval = std::chrono::milliseconds(DELAY);
+    int stepLog = 0;
+    size_t hashLifeMegabytes = 256;
+    const char* loadPath = nullptr;
+    const char* recordPath = nullptr;
+    // Pattern file placed with its origin at (patternX, patternY) from the
+    // window's top-left cell, and where to write the board at exit.
+    const char* patternPath = nullptr;
+    int64_t patternX = 0;
+    int64_t patternY = 0;
+    const char* exportPath = nullptr;
+    // B/S rule; without one, a pattern's own rule, else B3/S23.
+    const char* ruleText = nullptr;
+    // Board size, which also sets the window's; huge pages back its cells.
+    int boardWidth = DEFAULT_BOARD_SIZE;
+    int boardHeight = DEFAULT_BOARD_SIZE;
+    bool hugePages = false;
+    BenchOptions bench;
+    bench.count = 33; // initial live-cell percentage
+    ProfileOptions profile;
+    // Offscreen output steps one generation per frame, as fast as it can.
+    OutputOptions outputOptions;
+    for (int i = 1; i < argc; ++i) {
+        if (parseBenchOption(i, argc, argv, bench) || parseProfileOption(i, argc, argv, profile) ||
+            parseOutputOption(i, argc, argv, outputOptions)) {
+            continue;
+        } else if (std::strcmp(argv[i], "--engine") == 0 && i + 1 < argc) {
+            const char* name = argv[++i];
+            if (std::strcmp(name, "scalar") == 0) {
+                engine = Engine::Scalar;
+            } else if (std::strcmp(name, "bitpacked") == 0) {
+                engine = Engine::BitPacked;
+            } else if (std::strcmp(name, "verify") == 0) {
+                engine = Engine::Verify;
+            } else if (std::strcmp(name, "hashlife") == 0) {
+                engine = Engine::HashLife;
+            } else if (std::strcmp(name, "tiled") == 0) {
+                engine = Engine::Tiled;
+            } else {
+                std::cerr << "Unknown engine: " << name << " (expected scalar, bitpacked, verify, hashlife or tiled)" << std::endl;
+                return -1;
+            }
+        } else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threadCount = std::max(1, std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--step-log") == 0 && i + 1 < argc) {
+            // HashLife only: each displayed step advances 2^k generations.
+            stepLog = std::max(0, std::min(std::atoi(argv[++i]), 48));
+        } else if (std::strcmp(argv[i], "--load") == 0 && i + 1 < argc) {
+            loadPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            recordPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--pattern") == 0 && i + 1 < argc) {
+            patternPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--pattern-at") == 0 && i + 2 < argc) {
+            patternX = std::atoll(argv[++i]);
+            patternY = std::atoll(argv[++i]);
+        } else if (std::strcmp(argv[i], "--export") == 0 && i + 1 < argc) {
+            exportPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--rule") == 0 && i + 1 < argc) {
+            ruleText = argv[++i];
+        } else if (std::strcmp(argv[i], "--board-size") == 0 && i + 2 < argc) {
+            boardWidth = std::max(1, std::atoi(argv[++i]));
+            boardHeight = std::max(1, std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--huge-pages") == 0) {
+            hugePages = true;
+        } else if (std::strcmp(argv[i], "--pipelined") == 0) {
+            pipelined = true;
+        } else if (std::strcmp(argv[i], "--hashlife-mb") == 0 && i + 1 < argc) {
+            hashLifeMegabytes = std::max(1, std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--gps") == 0 && i + 1 < argc) {
+            // Target generations per second, or "max" for no delay at all.
+            const char* rate = argv[++i];
+            double gps = std::strcmp(rate, "max") == 0 ? 0.0 : std::atof(rate);
+            stepInterval = gps > 0.0
+                ? std::chrono::nanoseconds(static_cast<long long>(1e9 / gps))
+                : std::chrono::nanoseconds(0);
+        } else {
+            std::cerr << "Unknown option: " << argv[i] << "\n";
+            return -1;
+        }
+    }
+
+    parseLifeRule("B3/S23", rule);
+    if (ruleText && !parseLifeRule(ruleText, rule)) {
+        std::cerr << "Unknown rule: " << ruleText << " (expected B/S notation such as B36/S23, or B/S/C such as B2/S/C3)" << std::endl;
+        return -1;
+    }
+
+    // Cells keep CELL_SIZE pixels until the board outgrows MAX_WINDOW_PIXELS,
+    // then shrink so it still fits, down to the zoom limit.
+    gridView.cellPixels = std::max(MIN_CELL_PIXELS,
+        std::min<double>(CELL_SIZE, static_cast<double>(MAX_WINDOW_PIXELS) / std::max(boardWidth, boardHeight)));
+    const int windowPixelsX = static_cast<int>(std::ceil(boardWidth * gridView.cellPixels));
+    const int windowPixelsY = static_cast<int>(std::ceil(boardHeight * gridView.cellPixels));
+
+    Board display = makeBoard(boardWidth, boardHeight, hugePages);
+    Board swap = makeBoard(boardWidth, boardHeight, hugePages);
+    BitBoard bits = makeBitBoard(boardWidth, boardHeight);
+    BitBoard bitsNext = makeBitBoard(boardWidth, boardHeight);
+    if (loadPath && !loadLifeSnapshot(loadPath, display, ruleText != nullptr)) {
+        return -1;
+    }
+
+    HashLife universe;
+    if (engine == Engine::HashLife) {
+        initHashLife(universe, hashLifeMegabytes * 1024 * 1024 / sizeof(HashNode));
+    }
+    TiledBoard tiled;
+    // Board coordinates of the cell at display[0][0]. The unbounded engines
+    // start with cell (0, 0) in the middle of the window and move it as the
+    // view pans.
+    int64_t& viewX = gridView.boardX;
+    int64_t& viewY = gridView.boardY;
+    if (engine == Engine::HashLife || engine == Engine::Tiled) {
+        viewX = -boardWidth / 2;
+        viewY = -boardHeight / 2;
+        gridView.originX = static_cast<double>(viewX);
+        gridView.originY = static_cast<double>(viewY);
+    }
+
+    // Each generation is split into row bands on the work-stealing pool, a few
+    // per worker so a dense band does not hold the others up. runTasks returns
+    // once every band is stepped, which is the barrier between generations.
+    StealingPool pool;
+    startStealingPool(pool, std::min(threadCount, boardHeight));
+    const int bandCount = std::min(boardHeight, 4 * pool.workerCount);
+    auto stepRows = [&](int firstRow, int lastRow) {
+        if (engine != Engine::Scalar) stepBitBoardRows(bits, bitsNext, firstRow, lastRow);
+        if (engine != Engine::BitPacked) stepScalarRows(display, swap, firstRow, lastRow);
+    };
+    long long cellUpdates = 0;
+
+    // Writes cells edited in `display` into the unbounded engines.
+    auto storeEdits = [&] {
+        if (!boardEdited) return;
+        if (engine == Engine::HashLife) storeViewport(universe, viewX, viewY, display);
+        else storeTiledViewport(tiled, viewX, viewY, display);
+        boardEdited = false;
+    };
+
+    // Patterns go straight into the selected engine; the fixed-size engines
+    // keep only the part that lands on the board.
+    if (patternPath) {
+        PatternInfo info;
+        auto start = BenchClock::now();
+        bool ok;
+        if (engine == Engine::HashLife || engine == Engine::Tiled) {
+            storeEdits();
+            if (engine == Engine::HashLife) {
+                TiledBoard staging;
+                ok = importPatternTiles(patternPath, viewX + patternX, viewY + patternY, staging, info);
+                storeTiles(universe, staging);
+                renderViewport(universe, viewX, viewY, display);
+            } else {
+                ok = importPatternTiles(patternPath, viewX + patternX, viewY + patternY, tiled, info);
+                renderTiledViewport(tiled, viewX, viewY, display);
+            }
+        } else {
+            ok = importPatternBoard(patternPath, patternX, patternY, display, info);
+        }
+        if (!ok) return -1;
+        LifeRule patternRule;
+        if (!info.rule.empty() && !parseLifeRule(info.rule, patternRule)) {
+            std::cerr << "Pattern " << patternPath << " has unknown rule " << info.rule << "; running it as "
+                      << lifeRuleName(rule) << std::endl;
+        } else if (!info.rule.empty() && !ruleText && !loadPath) {
+            rule = patternRule;
+        } else if (!info.rule.empty() && lifeRuleName(patternRule) != lifeRuleName(rule)) {
+            std::cerr << "Pattern " << patternPath << " is for rule " << lifeRuleName(patternRule) << "; running it as "
+                      << lifeRuleName(rule) << std::endl;
+        }
+        std::cerr << "Loaded " << info.cells << " cells from " << patternPath << " in "
+                  << std::chrono::duration<double, std::milli>(BenchClock::now() - start).count() << " ms" << std::endl;
+    }
+
+    // Only the int board holds the dying states of a Generations rule, and
+    // the unbounded engines rely on empty space staying empty.
+    if (rule.states > 2 && engine != Engine::Scalar) {
+        std::cerr << "Generations rule " << lifeRuleName(rule) << " needs --engine scalar" << std::endl;
+        return -1;
+    }
+    if ((rule.birth & 1) && (engine == Engine::HashLife || engine == Engine::Tiled)) {
+        std::cerr << "Rule " << lifeRuleName(rule) << " gives birth on empty space; it needs a bounded engine" << std::endl;
+        return -1;
+    }
+
+    // Writes every live cell; the fixed-size engines write the board.
+    auto exportBoard = [&] {
+        if (!exportPath) return true;
+        TiledBoard cells;
+        if (engine == Engine::HashLife || engine == Engine::Tiled) {
+            storeEdits();
+            if (engine == Engine::Tiled) return exportPattern(exportPath, tiled);
+            hashLifeTiles(universe, cells);
+        } else {
+            boardTiles(display, cells);
+        }
+        return exportPattern(exportPath, cells);
+    };
+
+    // Recording starts from the board as it stands before the first step.
+    Board recordStartBoard;
+    int recordStartGeneration = 0;
+    auto startRecording = [&] {
+        if (!recordPath) return;
+        editRecorder.enabled = true;
+        editRecorder.changesOnly = false; // the same cell can be edited again in a later generation
+        recordStartBoard = display;
+        recordStartGeneration = generation;
+    };
+    auto finishRecording = [&] {
+        if (!editRecorder.enabled) return true;
+        return writeLifeSnapshot(recordPath, recordStartBoard, recordStartGeneration, editRecorder.events);
+    };
+
+    // Advances the board one displayed step with the selected engine, picking
+    // up any cells edited in `display` since the last step.
+    auto stepGeneration = [&] {
+        ProfileScope scope("step");
+        const long long stepCellUpdates = cellUpdates;
+        replayEdits(display);
+        if (engine == Engine::HashLife || engine == Engine::Tiled) {
+            storeEdits();
+            if (engine == Engine::HashLife) {
+                advanceHashLife(universe, stepLog);
+                renderViewport(universe, viewX, viewY, display);
+            } else {
+                stepTiledBoard(tiled);
+                cellUpdates += static_cast<long long>(tiled.scheduled.size()) * TILE_SIZE * TILE_SIZE;
+                renderTiledViewport(tiled, viewX, viewY, display);
+            }
+        } else {
+            if (engine != Engine::Scalar && boardEdited) {
+                packBoard(display, bits);
+                boardEdited = false;
+            }
+
+            runTasks(pool, bandCount, [&](int band, int) {
+                stepRows(boardHeight * band / bandCount, boardHeight * (band + 1) / bandCount);
+            });
+            cellUpdates += static_cast<long long>(boardWidth) * boardHeight;
+
+            if (engine != Engine::Scalar) {
+                std::swap(bits, bitsNext);
+            }
+            if (engine == Engine::BitPacked) {
+                unpackBoard(bits, display);
+            } else {
+                std::swap(display, swap);
+            }
+
+            if (engine == Engine::Verify) {
+                int mismatches = countMismatches(display, bits);
+                if (mismatches > 0) {
+                    std::cerr << "Generation " << generation << ": bit-packed engine differs in "
+                              << mismatches << " cells" << std::endl;
+                    packBoard(display, bits);
+                }
+            }
+        }
+        generation++;
+        profileCounter("generation", generation);
+        profileCounter("cell updates", cellUpdates - stepCellUpdates);
+    };
+
+    if (bench.enabled) {
+        // Seeded random soup over the whole window, stepped without a window,
+        // unless a snapshot or pattern was loaded.
+        if (!loadPath && !patternPath) {
+            std::mt19937 rng(bench.seed);
+            std::uniform_int_distribution<int> percent(0, 99);
+            for (int x = 0; x < boardWidth; ++x) {
+                for (int y = 0; y < boardHeight; ++y) {
+                    display[x][y] = percent(rng) < bench.count ? 1 : 0;
+                }
+            }
+            boardEdited = true;
+        }
+        startRecording();
+        startProfiling(profile);
+
+        auto start = BenchClock::now();
+        for (int step = 0; step < bench.steps; ++step) {
+            stepGeneration();
+        }
+        auto elapsed = BenchClock::now() - start;
+
+        stopStealingPool(pool);
+        printBenchReport("life", bench, elapsed, {
+            { "cell_updates", static_cast<double>(cellUpdates) },
+            { "generations", static_cast<double>(bench.steps) * (engine == Engine::HashLife ? std::ldexp(1.0, stepLog) : 1.0) },
+        });
+        bool saved = finishRecording();
+        saved = exportBoard() && saved;
+        saved = finishProfiling(profile) && saved;
+        unmapSnapshot(loadedSnapshot);
+        return saved ? 0 : -1;
+    }
+
+
     if (!glfwInit()) {
         std::cerr << "Failed to initialize GLFW" << std::endl;
         return -1;
     }
 
-    GLFWwindow* window = glfwCreateWindow(GAME_WIDTH * CELL_SIZE, GAME_HEIGHT * CELL_SIZE, "Game of Life", NULL, NULL);
+    hideOutputWindow(outputOptions);
+    GLFWwindow* window = glfwCreateWindow(windowPixelsX, windowPixelsY, "Game of Life", NULL, NULL);
     if (!window) {
         std::cerr << "Failed to create GLFW window" << std::endl;
         glfwTerminate();
@@ -122,43 +1677,259 @@ int main() {
 
     std::srand(std::time(0));
 
-    setupOpenGL(GAME_WIDTH * CELL_SIZE, GAME_HEIGHT * CELL_SIZE);
-
-    std::array<std::array<int, GAME_HEIGHT>, GAME_WIDTH> display {};
-    std::array<std::array<int, GAME_HEIGHT>, GAME_WIDTH> swap {};
+    setupOpenGL(windowPixelsX, windowPixelsY);
+    FrameOutput frameOutput;
+    if (outputOptions.path && !beginFrameOutput(frameOutput, outputOptions, windowPixelsX, windowPixelsY)) {
+        return -1;
+    }
 
-    // Initialize display to be blank
-    for (auto& row : display) {
-        std::fill(row.begin(), row.end(), 0);
+    // Initialize display to be blank, unless a snapshot or pattern was loaded
+    if (!loadPath && !patternPath) {
+        clearBoard(display);
     }
+    replayEdits(display);
+    startRecording();
 
     // Set the user pointer to the display array for the mouse callback
     glfwSetWindowUserPointer(window, &display);
     glfwSetMouseButtonCallback(window, mouseButtonCallback);
     glfwSetCursorPosCallback(window, cursorPosCallback);
 
-    bool startSimulation = false;
+    glfwSetScrollCallback(window, scrollCallback);
+
+    GridRenderer gridRenderer;
+    initGridRenderer(gridRenderer);
+    // Cells drawn: the whole board for the fixed-size engines, or the region
+    // under the window, however large the zoom makes it, for the unbounded ones.
+    BitBoard frame = makeBitBoard(boardWidth, boardHeight);
+    int64_t frameX = 0;
+    int64_t frameY = 0;
+    bool frameStale = true;
+    const double windowWidth = windowPixelsX;
+    const double windowHeight = windowPixelsY;
+    const bool unbounded = engine == Engine::HashLife || engine == Engine::Tiled;
+
+    // The cells under the window at the current pan and zoom.
+    auto windowRegion = [&] {
+        LifeMessage view;
+        view.kind = LifeMessageKind::View;
+        view.x = static_cast<int64_t>(std::floor(gridView.originX));
+        view.y = static_cast<int64_t>(std::floor(gridView.originY));
+        view.width = static_cast<int>(std::ceil(windowWidth / gridView.cellPixels)) + 1;
+        view.height = static_cast<int>(std::ceil(windowHeight / gridView.cellPixels)) + 1;
+        return view;
+    };
+    auto renderRegion = [&](BitBoard& cells, int64_t x, int64_t y) {
+        if (engine == Engine::HashLife) renderHashLifeRegion(universe, x, y, cells);
+        else renderTiledRegion(tiled, x, y, cells);
+    };
+    // Keeps `display`, which clicks edit, at the window's top-left cell.
+    auto moveViewport = [&](int64_t x, int64_t y) {
+        if (x == viewX && y == viewY) return;
+        storeEdits();
+        viewX = x;
+        viewY = y;
+        if (engine == Engine::HashLife) renderViewport(universe, viewX, viewY, display);
+        else renderTiledViewport(tiled, viewX, viewY, display);
+    };
+
+    ProfileOverlay overlay;
+    startProfiling(profile);
+
+    bool startSimulation = outputOptions.path != nullptr;
+    if (outputOptions.path) pipelined = false; // output frames follow their own clock on this thread
+
+    // Pipelined mode: applies the window's messages, steps on the same cadence
+    // as the serial loop, and publishes the cells in view whenever they may
+    // have changed. From here until it is joined, this thread owns the board
+    // and the engines.
+    auto simulationLoop = [&](LifeMessage view) {
+        bool running = false;
+        bool changed = true;
+        auto nextGeneration = std::chrono::steady_clock::now();
+        while (simulationRunning.load(std::memory_order_acquire)) {
+            LifeMessage message;
+            while (pop(lifeMessages, message)) {
+                if (message.kind == LifeMessageKind::Start) {
+                    running = true;
+                } else if (message.kind == LifeMessageKind::View) {
+                    view = message;
+                    if (unbounded) moveViewport(view.x, view.y);
+                    changed = true;
+                } else if (!replayActive(editReplay)) {
+                    int64_t cellX = message.x - viewX;
+                    int64_t cellY = message.y - viewY;
+                    if (cellX >= 0 && cellX < display.width && cellY >= 0 && cellY < display.height) {
+                        placePattern(display, static_cast<int>(cellX), static_cast<int>(cellY));
+                        changed = true;
+                    }
+                }
+            }
+
+            auto now = std::chrono::steady_clock::now();
+            if (running && now >= nextGeneration) {
+                stepGeneration();
+                changed = true;
+                nextGeneration += stepInterval;
+                if (nextGeneration < now) nextGeneration = now;
+            }
+
+            if (changed) {
+                LifeFrame& out = backSlot(lifeFrames);
+                if (unbounded) {
+                    storeEdits();
+                    if (out.cells.width != view.width || out.cells.height != view.height) {
+                        out.cells = makeBitBoard(view.width, view.height);
+                    }
+                    out.x = view.x;
+                    out.y = view.y;
+                    renderRegion(out.cells, view.x, view.y);
+                } else if (engine == Engine::Scalar || boardEdited) {
+                    packBoard(display, out.cells);
+                } else {
+                    out.cells.words = bits.words;
+                }
+                publish(lifeFrames);
+                changed = false;
+            }
+
+            // Wake often enough to pick up input while waiting for a generation.
+            auto wake = now + std::chrono::milliseconds(2);
+            if (running && nextGeneration < wake) wake = nextGeneration;
+            std::this_thread::sleep_until(wake);
+        }
+    };
+    std::thread simulation;
+    LifeMessage sentView = windowRegion();
+    if (pipelined) {
+        for (LifeFrame& slot : lifeFrames.slots) slot.cells = makeBitBoard(boardWidth, boardHeight);
+        simulationRunning.store(true, std::memory_order_release);
+        simulation = std::thread(simulationLoop, sentView);
+    }
+
+    auto nextGeneration = std::chrono::steady_clock::now();
     while (!glfwWindowShouldClose(window)) {
         glClear(GL_COLOR_BUFFER_BIT);
-        drawGrid(display);
-        glfwSwapBuffers(window);
+        {
+            ProfileScope scope("upload");
+            if (pipelined) {
+                if (acquire(lifeFrames) || frameStale) {
+                    const LifeFrame& shown = frontSlot(lifeFrames);
+                    frameX = shown.x;
+                    frameY = shown.y;
+                    uploadGridRows(gridRenderer, shown.cells.words.data(), shown.cells.wordsPerRow,
+                                   shown.cells.width, shown.cells.height);
+                    frameStale = false;
+                }
+            } else if (unbounded) {
+                if (boardEdited) {
+                    storeEdits();
+                    frameStale = true;
+                }
+                LifeMessage view = windowRegion();
+                if (frameStale || view.x != frameX || view.y != frameY ||
+                    view.width != frame.width || view.height != frame.height) {
+                    if (view.width != frame.width || view.height != frame.height) {
+                        frame = makeBitBoard(view.width, view.height);
+                    }
+                    frameX = view.x;
+                    frameY = view.y;
+                    renderRegion(frame, frameX, frameY);
+                    uploadGridRows(gridRenderer, frame.words.data(), frame.wordsPerRow, frame.width, frame.height);
+                    frameStale = false;
+                }
+            } else {
+                // The bit-packed board is current unless cells were edited since the last step.
+                const BitBoard* cells = &bits;
+                if (engine == Engine::Scalar || boardEdited) {
+                    packBoard(display, frame);
+                    cells = &frame;
+                }
+                uploadGridRows(gridRenderer, cells->words.data(), cells->wordsPerRow, cells->width, cells->height);
+            }
+        }
+        {
+            ProfileScope scope("draw");
+            const BitBoard& shown = pipelined ? frontSlot(lifeFrames).cells : frame;
+            float left = static_cast<float>((frameX - gridView.originX) * gridView.cellPixels);
+            float top = static_cast<float>((frameY - gridView.originY) * gridView.cellPixels);
+            drawGridTexture(gridRenderer, left, top,
+                            left + static_cast<float>(shown.width * gridView.cellPixels),
+                            top + static_cast<float>(shown.height * gridView.cellPixels));
+        }
+        if (profile.overlay) {
+            collectProfile(overlay);
+            drawProfileOverlay(overlay);
+        }
+        if (outputOptions.path) {
+            ProfileScope scope("readback");
+            submitFrame(frameOutput);
+        } else {
+            ProfileScope scope("swap");
+            glfwSwapBuffers(window);
+        }
         glfwPollEvents();
 
         if (glfwGetKey(window, GLFW_KEY_ENTER) == GLFW_PRESS) {
+            if (pipelined && !startSimulation) {
+                LifeMessage start;
+                start.kind = LifeMessageKind::Start;
+                push(lifeMessages, start);
+            }
             startSimulation = true;
         }
 
+        // Arrows pan a tenth of the window per frame; +/- or the scroll wheel zoom.
+        int panX = (glfwGetKey(window, GLFW_KEY_RIGHT) == GLFW_PRESS) - (glfwGetKey(window, GLFW_KEY_LEFT) == GLFW_PRESS);
+        int panY = (glfwGetKey(window, GLFW_KEY_DOWN) == GLFW_PRESS) - (glfwGetKey(window, GLFW_KEY_UP) == GLFW_PRESS);
+        gridView.originX += panX * windowWidth / gridView.cellPixels / 10;
+        gridView.originY += panY * windowHeight / gridView.cellPixels / 10;
+        int zoom = (glfwGetKey(window, GLFW_KEY_EQUAL) == GLFW_PRESS) - (glfwGetKey(window, GLFW_KEY_MINUS) == GLFW_PRESS);
+        if (zoom != 0) {
+            zoomView(gridView, zoom > 0 ? 1.05 : 1.0 / 1.05, windowWidth / 2, windowHeight / 2);
+        }
+
+        if (pipelined) {
+            LifeMessage view = windowRegion();
+            if (view.x != sentView.x || view.y != sentView.y ||
+                view.width != sentView.width || view.height != sentView.height) {
+                push(lifeMessages, view);
+                sentView = view;
+            }
+            continue;
+        }
+
+        if (unbounded) {
+            moveViewport(static_cast<int64_t>(std::floor(gridView.originX)),
+                         static_cast<int64_t>(std::floor(gridView.originY)));
+        }
+
         if (startSimulation) {
-            for (int x = 0; x < GAME_WIDTH; ++x) {
-                for (int y = 0; y < GAME_HEIGHT; ++y) {
-                    swap[x][y] = isAlive(display, x, y) ? 1 : 0;
-                }
+            stepGeneration();
+            frameStale = true;
+
+            if (stepInterval.count() > 0 && !outputOptions.path) {
+                // Fixed cadence instead of a fixed sleep, so step cost does not
+                // lower the rate; after a stall, resume rather than catch up.
+                nextGeneration += stepInterval;
+                auto now = std::chrono::steady_clock::now();
+                if (nextGeneration < now) nextGeneration = now;
+                std::this_thread::sleep_until(nextGeneration);
             }
-            std::swap(display, swap);
-            std::this_thread::sleep_for(std::chrono::milliseconds(DELAY));
         }
+        if (outputOptions.path && outputComplete(frameOutput, outputOptions)) break;
+    }
+    if (pipelined) {
+        simulationRunning.store(false, std::memory_order_release);
+        simulation.join();
     }
 
+    stopStealingPool(pool);
+    bool written = finishFrameOutput(frameOutput, outputOptions);
     glfwTerminate();
-    return 0;
+    bool saved = finishRecording() && written;
+    saved = exportBoard() && saved;
+    saved = finishProfiling(profile) && saved;
+    unmapSnapshot(loadedSnapshot);
+    return saved ? 0 : -1;
 }
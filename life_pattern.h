@@ -0,0 +1,321 @@
+#pragma once
+
+// Streaming import and export of Life patterns in RLE and Life 1.06 format.
+// Files are read through a fixed-size buffer and decoded as they arrive, so a
+// pattern of any size is loaded without holding its text in memory: each run
+// of live cells goes to a sink as soon as it is decoded, as
+// addRun(x, y, length) with (x, y) the run's leftmost cell.
+//
+// RLE files are "#" comment lines, an "x = w, y = h, rule = B3/S23" header and
+// a body of <count><tag> items: b dead, o (or any other state letter) alive,
+// $ end of row, ! end of pattern. Life 1.06 files start with "#Life 1.06" and
+// list one "x y" live cell per line.
+
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+enum class PatternFormat {
+    Rle,
+    Life106
+};
+
+struct PatternInfo {
+    PatternFormat format = PatternFormat::Rle;
+    int64_t width = 0;  // from the RLE header, 0 if absent
+    int64_t height = 0;
+    std::string rule;   // from the RLE header, empty if absent
+    uint64_t cells = 0; // live cells read
+};
+
+// .lif and .life files are Life 1.06; everything else is RLE.
+inline PatternFormat patternFormatForPath(const char* path) {
+    const char* dot = std::strrchr(path, '.');
+    if (dot && (std::strcmp(dot, ".lif") == 0 || std::strcmp(dot, ".life") == 0)) return PatternFormat::Life106;
+    return PatternFormat::Rle;
+}
+
+struct PatternReader {
+    std::FILE* file = nullptr;
+    std::vector<char> buffer = std::vector<char>(1 << 16);
+    size_t size = 0;
+    size_t position = 0;
+    long long line = 1;
+};
+
+inline int readChar(PatternReader& in) {
+    if (in.position == in.size) {
+        in.size = std::fread(in.buffer.data(), 1, in.buffer.size(), in.file);
+        in.position = 0;
+        if (in.size == 0) return EOF;
+    }
+    char c = in.buffer[in.position++];
+    if (c == '\n') in.line++;
+    return static_cast<unsigned char>(c);
+}
+
+inline void skipLine(PatternReader& in) {
+    int c;
+    do {
+        c = readChar(in);
+    } while (c != '\n' && c != EOF);
+}
+
+// The rest of the current line, up to a sanity limit; headers are short.
+inline std::string readLine(PatternReader& in) {
+    std::string text;
+    for (int c = readChar(in); c != '\n' && c != EOF; c = readChar(in)) {
+        if (text.size() < 4096) text += static_cast<char>(c);
+    }
+    return text;
+}
+
+inline std::string trimmed(const std::string& text) {
+    size_t first = text.find_first_not_of(" \t\r");
+    if (first == std::string::npos) return "";
+    return text.substr(first, text.find_last_not_of(" \t\r") + 1 - first);
+}
+
+// Parses "x = 3, y = 3, rule = B3/S23"; fields may come in any order.
+inline void parseRleHeader(const std::string& line, PatternInfo& info) {
+    size_t start = 0;
+    while (start <= line.size()) {
+        size_t end = line.find(',', start);
+        if (end == std::string::npos) end = line.size();
+        std::string field = line.substr(start, end - start);
+        size_t equals = field.find('=');
+        if (equals != std::string::npos) {
+            std::string key = trimmed(field.substr(0, equals));
+            std::string value = trimmed(field.substr(equals + 1));
+            if (key == "x") info.width = std::atoll(value.c_str());
+            else if (key == "y") info.height = std::atoll(value.c_str());
+            else if (key == "rule") info.rule = value;
+        }
+        start = end + 1;
+    }
+}
+
+template <typename Sink>
+bool readRle(PatternReader& in, const char* path, Sink& addRun, PatternInfo& info) {
+    int64_t x = 0, y = 0, count = 0;
+    bool lineStart = true;
+    bool bodyStarted = false;
+    for (int c = readChar(in); c != EOF; c = readChar(in)) {
+        if (lineStart && (c == '#' || (c == 'x' && !bodyStarted))) {
+            if (c == '#') skipLine(in);
+            else parseRleHeader("x" + readLine(in), info);
+            continue;
+        }
+        lineStart = c == '\n';
+        if (c >= '0' && c <= '9') {
+            if (count > (int64_t(1) << 40)) {
+                std::cerr << "Pattern " << path << " line " << in.line << ": run count too large" << std::endl;
+                return false;
+            }
+            count = count * 10 + (c - '0');
+            continue;
+        }
+        if (std::isspace(c)) continue;
+        bodyStarted = true;
+        int64_t run = count > 0 ? count : 1;
+        count = 0;
+        if (c == '!') {
+            return true;
+        } else if (c == '$') {
+            y += run;
+            x = 0;
+        } else if (c == 'b' || c == '.') {
+            x += run;
+        } else if (std::isalpha(c)) {
+            // Multi-state letters count as alive; p-y prefix a second letter.
+            if (c >= 'p' && c <= 'y') readChar(in);
+            addRun(x, y, run);
+            info.cells += run;
+            x += run;
+        } else {
+            std::cerr << "Pattern " << path << " line " << in.line << ": unexpected '"
+                      << static_cast<char>(c) << "'" << std::endl;
+            return false;
+        }
+    }
+    return true; // a missing '!' is tolerated
+}
+
+// Reads an optionally signed integer starting at `c`; returns the character
+// after it in `c`.
+inline bool readInteger(PatternReader& in, int& c, int64_t& value) {
+    bool negative = c == '-';
+    if (c == '-' || c == '+') c = readChar(in);
+    if (c < '0' || c > '9') return false;
+    value = 0;
+    int digits = 0;
+    for (; c >= '0' && c <= '9'; c = readChar(in)) {
+        if (++digits > 18) return false;
+        value = value * 10 + (c - '0');
+    }
+    if (negative) value = -value;
+    return true;
+}
+
+// Cells that continue a run along a row are merged before reaching the sink.
+template <typename Sink>
+bool readLife106(PatternReader& in, const char* path, Sink& addRun, PatternInfo& info) {
+    skipLine(in); // "#Life 1.06"
+    int64_t runX = 0, runY = 0, runLength = 0;
+    while (true) {
+        int c = readChar(in);
+        while (c == ' ' || c == '\t' || c == '\r' || c == '\n') c = readChar(in);
+        if (c == EOF) break;
+        if (c == '#') {
+            skipLine(in);
+            continue;
+        }
+        int64_t x, y;
+        bool ok = readInteger(in, c, x);
+        while (ok && (c == ' ' || c == '\t')) c = readChar(in);
+        ok = ok && readInteger(in, c, y);
+        while (ok && (c == ' ' || c == '\t' || c == '\r')) c = readChar(in);
+        if (!ok || (c != '\n' && c != EOF)) {
+            std::cerr << "Pattern " << path << " line " << in.line << ": expected \"x y\"" << std::endl;
+            return false;
+        }
+        info.cells++;
+        if (runLength > 0 && y == runY && x == runX + runLength) {
+            runLength++;
+            continue;
+        }
+        if (runLength > 0) addRun(runX, runY, runLength);
+        runX = x;
+        runY = y;
+        runLength = 1;
+        if (c == EOF) break;
+    }
+    if (runLength > 0) addRun(runX, runY, runLength);
+    return true;
+}
+
+// Streams the pattern at `path` into addRun(x, y, length), with x and y
+// relative to the pattern's own origin. The format is detected from the file.
+template <typename Sink>
+bool readPattern(const char* path, Sink&& addRun, PatternInfo& info) {
+    PatternReader in;
+    in.file = std::fopen(path, "rb");
+    if (!in.file) {
+        std::cerr << "Cannot open pattern " << path << std::endl;
+        return false;
+    }
+    info = PatternInfo();
+    in.size = std::fread(in.buffer.data(), 1, in.buffer.size(), in.file);
+    const char* start = in.buffer.data();
+    bool ok;
+    if (in.size >= 10 && std::memcmp(start, "#Life 1.06", 10) == 0) {
+        info.format = PatternFormat::Life106;
+        ok = readLife106(in, path, addRun, info);
+    } else if (in.size >= 5 && std::memcmp(start, "#Life", 5) == 0) {
+        std::cerr << "Pattern " << path << " is not Life 1.06 or RLE" << std::endl;
+        ok = false;
+    } else {
+        ok = readRle(in, path, addRun, info);
+    }
+    if (ok && std::ferror(in.file)) {
+        std::cerr << "Failed reading pattern " << path << std::endl;
+        ok = false;
+    }
+    std::fclose(in.file);
+    return ok;
+}
+
+// Writes runs of live cells, given in row-major order, as a pattern file.
+// RLE needs the bounding box up front for its header; runs are merged when
+// they touch, and lines are wrapped at 70 characters as the format asks.
+struct PatternWriter {
+    std::FILE* file = nullptr;
+    PatternFormat format = PatternFormat::Rle;
+    int64_t originX = 0, originY = 0;           // top-left of the bounding box
+    int64_t row = 0, column = 0;                // RLE position written so far
+    int64_t runX = 0, runY = 0, runLength = 0;  // run not yet written
+    int lineLength = 0;
+};
+
+// Life 1.06 has no rule header, so `rule` goes only into RLE files.
+inline bool beginPatternWrite(PatternWriter& out, const char* path, PatternFormat format, const std::string& rule,
+                              int64_t minX, int64_t minY, int64_t width, int64_t height) {
+    out = PatternWriter();
+    out.file = std::fopen(path, "wb");
+    if (!out.file) {
+        std::cerr << "Cannot write pattern " << path << std::endl;
+        return false;
+    }
+    out.format = format;
+    out.originX = minX;
+    out.originY = minY;
+    if (format == PatternFormat::Life106) {
+        std::fputs("#Life 1.06\n", out.file);
+    } else {
+        std::fprintf(out.file, "x = %lld, y = %lld, rule = %s\n",
+                     static_cast<long long>(width), static_cast<long long>(height), rule.c_str());
+    }
+    return true;
+}
+
+inline void writeRleItem(PatternWriter& out, int64_t count, char tag) {
+    char item[32];
+    int length = count > 1 ? std::snprintf(item, sizeof(item), "%lld%c", static_cast<long long>(count), tag)
+                           : std::snprintf(item, sizeof(item), "%c", tag);
+    if (out.lineLength + length > 70) {
+        std::fputc('\n', out.file);
+        out.lineLength = 0;
+    }
+    std::fputs(item, out.file);
+    out.lineLength += length;
+}
+
+inline void flushRun(PatternWriter& out) {
+    if (out.runLength == 0) return;
+    int64_t x = out.runX - out.originX;
+    int64_t y = out.runY - out.originY;
+    if (y > out.row) {
+        writeRleItem(out, y - out.row, '$');
+        out.row = y;
+        out.column = 0;
+    }
+    if (x > out.column) writeRleItem(out, x - out.column, 'b');
+    writeRleItem(out, out.runLength, 'o');
+    out.column = x + out.runLength;
+    out.runLength = 0;
+}
+
+inline void writeRun(PatternWriter& out, int64_t x, int64_t y, int64_t length) {
+    if (out.format == PatternFormat::Life106) {
+        for (int64_t i = 0; i < length; ++i) {
+            std::fprintf(out.file, "%lld %lld\n", static_cast<long long>(x + i), static_cast<long long>(y));
+        }
+        return;
+    }
+    if (out.runLength > 0 && y == out.runY && x == out.runX + out.runLength) {
+        out.runLength += length;
+        return;
+    }
+    flushRun(out);
+    out.runX = x;
+    out.runY = y;
+    out.runLength = length;
+}
+
+inline bool finishPatternWrite(PatternWriter& out, const char* path) {
+    if (out.format == PatternFormat::Rle) {
+        flushRun(out);
+        writeRleItem(out, 1, '!');
+        std::fputc('\n', out.file);
+    }
+    bool ok = !std::ferror(out.file);
+    ok = std::fclose(out.file) == 0 && ok;
+    out.file = nullptr;
+    if (!ok) std::cerr << "Failed writing pattern " << path << std::endl;
+    return ok;
+}
@@ -0,0 +1,132 @@
+#pragma once
+
+// Outer-totalistic cellular automaton rules, compiled into lookup tables.
+//
+// A rule is written "B<counts>/S<counts>": a dead cell is born with any of the
+// birth counts of live neighbours and a live cell survives with any of the
+// survival counts, e.g. B3/S23 (Life) or B36/S23 (HighLife). The older
+// "<survival>/<birth>" form ("23/3") is accepted too.
+//
+// Generations rules add a state count, "B2/S/C3" or "<survival>/<birth>/<states>"
+// ("/2/3" is Brian's Brain). A live cell that does not survive starts dying
+// instead of dying at once: it steps through states 2 .. states - 1, one a
+// generation, and then becomes dead. Only state 1 counts as a live neighbour,
+// and dying cells cannot be born into or survive.
+//
+// Parsing compiles the rule into two tables, so the engines step any rule
+// with lookups instead of branching on it:
+//  - transition[state * 9 + count], the next state of a cell in `state` with
+//    `count` live neighbours;
+//  - neighbourhood[bits], the next value (0 or 1) of the centre of a two-state
+//    3x3 neighbourhood packed row by row into nine bits, centre at bit 4.
+
+#include <cctype>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+const int MAX_RULE_STATES = 256;
+
+struct LifeRule {
+    uint16_t birth = 0;    // bit n: born with n live neighbours
+    uint16_t survival = 0; // bit n: survives with n live neighbours
+    int states = 2;
+    std::vector<uint8_t> transition;
+    uint8_t neighbourhood[512] = {};
+};
+
+inline bool isConwayRule(const LifeRule& rule) {
+    return rule.states == 2 && rule.birth == (1 << 3) && rule.survival == ((1 << 2) | (1 << 3));
+}
+
+// Canonical B/S (or B/S/C) name.
+inline std::string lifeRuleName(const LifeRule& rule) {
+    std::string name = "B";
+    for (int n = 0; n <= 8; ++n) {
+        if (rule.birth >> n & 1) name += static_cast<char>('0' + n);
+    }
+    name += "/S";
+    for (int n = 0; n <= 8; ++n) {
+        if (rule.survival >> n & 1) name += static_cast<char>('0' + n);
+    }
+    if (rule.states > 2) name += "/C" + std::to_string(rule.states);
+    return name;
+}
+
+inline void compileLifeRule(LifeRule& rule) {
+    rule.transition.assign(static_cast<size_t>(rule.states) * 9, 0);
+    const uint8_t dying = rule.states > 2 ? 2 : 0;
+    for (int count = 0; count <= 8; ++count) {
+        rule.transition[count] = rule.birth >> count & 1;
+        rule.transition[9 + count] = rule.survival >> count & 1 ? 1 : dying;
+        for (int state = 2; state < rule.states; ++state) {
+            rule.transition[state * 9 + count] = state + 1 < rule.states ? static_cast<uint8_t>(state + 1) : 0;
+        }
+    }
+    for (int bits = 0; bits < 512; ++bits) {
+        int centre = bits >> 4 & 1;
+        int count = __builtin_popcount(bits) - centre;
+        rule.neighbourhood[bits] = rule.transition[centre * 9 + count] == 1 ? 1 : 0;
+    }
+}
+
+// Reads a run of neighbour counts 0-8 into a bit set; false on anything else.
+inline bool parseRuleCounts(const std::string& text, uint16_t& counts) {
+    counts = 0;
+    for (char c : text) {
+        if (c < '0' || c > '8') return false;
+        counts |= static_cast<uint16_t>(1 << (c - '0'));
+    }
+    return true;
+}
+
+// Parses and compiles `text`; false, leaving `rule` unchanged, if it is not a
+// rule in one of the notations above. Case and spaces are ignored.
+inline bool parseLifeRule(const std::string& text, LifeRule& rule) {
+    std::vector<std::string> parts(1);
+    for (char c : text) {
+        if (std::isspace(static_cast<unsigned char>(c))) continue;
+        if (c == '/') parts.emplace_back();
+        else parts.back() += static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+    }
+    if (parts.size() < 2 || parts.size() > 3) return false;
+
+    LifeRule parsed;
+    std::string birth, survival, states;
+    bool tagged = false;
+    for (const std::string& part : parts) {
+        if (!part.empty() && std::isalpha(static_cast<unsigned char>(part[0]))) tagged = true;
+    }
+    if (tagged) {
+        // The state count may also go untagged in third place, as in B2/S/3.
+        std::string* fields[3] = { &birth, &survival, &states };
+        bool seen[3] = {};
+        for (size_t p = 0; p < parts.size(); ++p) {
+            const std::string& part = parts[p];
+            if (part.empty()) return false;
+            int slot = part[0] == 'B' ? 0 : part[0] == 'S' ? 1 : (part[0] == 'C' || part[0] == 'G') ? 2 : -1;
+            bool untagged = slot < 0 && p == 2 && std::isdigit(static_cast<unsigned char>(part[0]));
+            if (untagged) slot = 2;
+            if (slot < 0 || seen[slot]) return false;
+            seen[slot] = true;
+            *fields[slot] = untagged ? part : part.substr(1);
+        }
+        if (!seen[0] || !seen[1]) return false;
+    } else {
+        survival = parts[0];
+        birth = parts[1];
+        if (parts.size() == 3) states = parts[2];
+    }
+
+    if (!parseRuleCounts(birth, parsed.birth) || !parseRuleCounts(survival, parsed.survival)) return false;
+    if (parts.size() == 3) {
+        if (states.empty() || states.size() > 3 ||
+            states.find_first_not_of("0123456789") != std::string::npos) return false;
+        parsed.states = std::atoi(states.c_str());
+        if (parsed.states < 2 || parsed.states > MAX_RULE_STATES) return false;
+    }
+    compileLifeRule(parsed);
+    rule = std::move(parsed);
+    return true;
+}
@@ -0,0 +1,351 @@
+#pragma once
+
+// The driver the particle programs share around their physics: the cursor
+// spawner, input from the window or a replay, the fixed tick, snapshot
+// recording and loading, and running the window, with the physics inline or
+// on its own thread. A program keeps one ParticleDriver for its scene type and
+// supplies the two steps that depend on its broadphase as overloads on that
+// driver, which the templates here find by argument-dependent lookup:
+//
+//   void updatePhysics(ParticleDriver<Scene>&, float dt);     // one substep
+//   void updateSleep(ParticleDriver<Scene>&, float substepDt); // once per tick
+//
+// Scene setup, the broadphase, seeding and drawing stay with the programs.
+
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include "bench.h"
+#include "fixed_step.h"
+#include "frame_output.h"
+#include "particle_sleep.h"
+#include "particle_store.h"
+#include "pipeline.h"
+#include "profiler.h"
+#include "snapshot.h"
+
+template <typename Scene>
+struct ParticleDriver {
+    ParticleStore particles;
+    RenderPositions renderPositions;
+    FixedStep fixedStep;
+    ParticleSleep sleeping; // --no-sleep turns it off
+
+    // While spawnHeld, a particle appears at the cursor every spawnInterval.
+    double spawnX = 0.0, spawnY = 0.0;
+    bool spawnHeld = false;
+    float spawnInterval = 0.0f;
+    float lastSpawnTime = 0.0f;
+    float simulationTime = 0.0f;
+
+    // Snapshot and replay: --record saves the state recording started from
+    // plus every input change, tagged with its physics tick; --load restores a
+    // snapshot and replays any input it holds.
+    uint64_t tickCount = 0;
+    InputRecorder recorder;
+    InputReplay replay;
+    MappedSnapshot loadedSnapshot;
+    const char* loadPath = nullptr;
+    const char* recordPath = nullptr;
+    SnapshotHeader recordStart;
+    ParticleStore recordStartState;
+
+    // Pipelined mode (--pipelined): the physics runs on its own thread and
+    // hands each new state to the render thread through a triple buffer, and
+    // the input callbacks forward to it over a queue.
+    bool pipelined = false;
+    TripleBuffer<ParticleFrame> frames;
+    SpscQueue<InputMessage, 1024> inputQueue;
+    std::atomic<bool> simulationRunning{false};
+
+    // Particle pool (--capacity, --lifetime): spawning stops while the pool is
+    // full. At the end of each tick, particles older than the lifetime (0 keeps
+    // them forever) or further than `reach` from the origin are removed.
+    std::size_t capacity = 4096;
+    float lifetime = 0.0f;
+    float reach = 2.0f;
+
+    // Totals for the benchmark report; the broadphase adds to the pair counts.
+    long long pairTests = 0;
+    long long contacts = 0;
+    long long awakeTicks = 0;
+
+    // Phase timers and counters (--profile, --trace)
+    ProfileOptions profileOptions;
+    ProfileOverlay profileOverlay;
+
+    // Offscreen output (--output): frames go to a file instead of the window,
+    // on a clock that advances 1 / --fps per frame.
+    OutputOptions outputOptions;
+    FrameOutput frameOutput;
+};
+
+// Consumes argv[i] (and its value) if it is a driver option.
+template <typename Scene>
+bool parseDriverOption(int& i, int argc, char** argv, ParticleDriver<Scene>& driver) {
+    if (std::strcmp(argv[i], "--load") == 0 && i + 1 < argc) {
+        driver.loadPath = argv[++i];
+    } else if (std::strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+        driver.recordPath = argv[++i];
+    } else if (std::strcmp(argv[i], "--pipelined") == 0) {
+        driver.pipelined = true;
+    } else if (std::strcmp(argv[i], "--no-sleep") == 0) {
+        driver.sleeping.enabled = false;
+    } else if (std::strcmp(argv[i], "--capacity") == 0 && i + 1 < argc) {
+        driver.capacity = static_cast<std::size_t>(std::max(1, std::atoi(argv[++i])));
+    } else if (std::strcmp(argv[i], "--lifetime") == 0 && i + 1 < argc) {
+        driver.lifetime = static_cast<float>(std::atof(argv[++i]));
+    } else {
+        return parseFixedStepOption(i, argc, argv, driver.fixedStep) ||
+               parseProfileOption(i, argc, argv, driver.profileOptions) ||
+               parseOutputOption(i, argc, argv, driver.outputOptions);
+    }
+    return true;
+}
+
+// Window input, applied on the thread that runs the physics. Live input is
+// ignored while a recording replays.
+template <typename Scene>
+void applyInput(ParticleDriver<Scene>& driver, const InputMessage& message) {
+    if (replayActive(driver.replay)) return;
+    if (message.moved) {
+        driver.spawnX = message.x;
+        driver.spawnY = message.y;
+    }
+    if (message.action >= 0) driver.spawnHeld = message.action == 1;
+}
+
+template <typename Scene>
+void sendInput(ParticleDriver<Scene>& driver, const InputMessage& message) {
+    if (driver.pipelined) push(driver.inputQueue, message);
+    else applyInput(driver, message);
+}
+
+// Applies replayed input due this tick, or records live input.
+template <typename Scene>
+void updateInput(ParticleDriver<Scene>& driver) {
+    InputEvent event;
+    while (nextInput(driver.replay, driver.tickCount, event)) {
+        driver.spawnX = event.x;
+        driver.spawnY = event.y;
+        driver.spawnHeld = (event.buttons & 1) != 0;
+    }
+    recordInput(driver.recorder, driver.tickCount, static_cast<float>(driver.spawnX),
+                static_cast<float>(driver.spawnY), driver.spawnHeld ? 1 : 0);
+}
+
+// Advances the clock by one substep and spawns at the cursor if one is due.
+// Call at the end of updatePhysics().
+template <typename Scene>
+void updateSpawner(ParticleDriver<Scene>& driver, float dt) {
+    ProfileScope scope("spawn");
+    driver.simulationTime += dt;
+    if (driver.spawnHeld && driver.simulationTime - driver.lastSpawnTime >= driver.spawnInterval) {
+        ParticleHandle spawned = addParticle(driver.particles, static_cast<float>(driver.spawnX),
+                                             static_cast<float>(driver.spawnY), driver.simulationTime);
+        if (validHandle(spawned)) {
+            wakeParticle(driver.sleeping, driver.particles, static_cast<int>(driver.particles.size()) - 1,
+                         &driver.renderPositions);
+        }
+        driver.lastSpawnTime = driver.simulationTime;
+    }
+}
+
+// One fixed physics tick, split into substeps.
+template <typename Scene>
+void runTick(ParticleDriver<Scene>& driver, float dt) {
+    const long long tickPairTests = driver.pairTests;
+    const long long tickContacts = driver.contacts;
+    const float substep = dt / driver.fixedStep.substeps;
+    updateInput(driver);
+    for (int i = 0; i < driver.fixedStep.substeps; ++i) {
+        updatePhysics(driver, substep);
+    }
+    driver.tickCount++;
+    {
+        ProfileScope scope("sleep");
+        updateSleep(driver, substep);
+    }
+    driver.awakeTicks += driver.sleeping.awakeCount;
+    profileCounter("particles", static_cast<int64_t>(driver.particles.size()));
+    profileCounter("awake", driver.sleeping.awakeCount);
+    profileCounter("pair tests", driver.pairTests - tickPairTests);
+    profileCounter("contacts", driver.contacts - tickContacts);
+
+    ProfileScope scope("expire");
+    expireParticles(driver.particles, driver.simulationTime, driver.lifetime, driver.reach);
+    compactSleeping(driver.sleeping, driver.particles, &driver.renderPositions);
+}
+
+template <typename Scene>
+SnapshotHeader stateHeader(const ParticleDriver<Scene>& driver, float dt) {
+    SnapshotHeader header;
+    header.step = driver.tickCount;
+    header.time = driver.simulationTime;
+    header.spawnTime = driver.lastSpawnTime;
+    header.tickDt = dt;
+    header.substeps = driver.fixedStep.substeps;
+    return header;
+}
+
+template <typename Scene>
+void startRecording(ParticleDriver<Scene>& driver, float dt) {
+    if (!driver.recordPath) return;
+    driver.recorder.enabled = true;
+    driver.recordStart = stateHeader(driver, dt);
+    // Sleep state is not saved, so recording starts with everything awake,
+    // just as a replay of it will.
+    wakeAll(driver.sleeping, driver.particles);
+    driver.recordStartState = driver.particles;
+}
+
+template <typename Scene>
+bool finishRecording(ParticleDriver<Scene>& driver) {
+    if (!driver.recorder.enabled) return true;
+    return writeParticleSnapshot(driver.recordPath, driver.recordStart, driver.recordStartState,
+                                 driver.recorder.events);
+}
+
+template <typename Scene>
+bool loadSnapshot(ParticleDriver<Scene>& driver, const char* path) {
+    if (!mapSnapshot(path, SNAPSHOT_PARTICLES, driver.loadedSnapshot)) return false;
+    if (!loadParticleSnapshot(driver.loadedSnapshot, driver.particles)) return false;
+    const SnapshotHeader& header = *driver.loadedSnapshot.header;
+    driver.tickCount = header.step;
+    driver.simulationTime = static_cast<float>(header.time);
+    driver.lastSpawnTime = static_cast<float>(header.spawnTime);
+    driver.fixedStep.rate = 1.0f / header.tickDt;
+    driver.fixedStep.substeps = std::max(1u, header.substeps);
+    driver.replay = snapshotInput(driver.loadedSnapshot);
+    return true;
+}
+
+// After the options are parsed: loads --load, which also sets the benchmark's
+// dt and count, sizes the pool and starts profiling. A benchmark gets room for
+// its seeded particles and one spawn per substep, so it never runs into the cap.
+template <typename Scene>
+bool startDriver(ParticleDriver<Scene>& driver, BenchOptions& bench) {
+    if (driver.loadPath) {
+        if (!loadSnapshot(driver, driver.loadPath)) return false;
+        bench.dt = driver.loadedSnapshot.header->tickDt;
+        bench.count = static_cast<int>(driver.particles.size());
+    }
+    if (bench.enabled) {
+        driver.capacity = std::max(driver.capacity, static_cast<std::size_t>(bench.count) +
+                                   static_cast<std::size_t>(bench.steps) * driver.fixedStep.substeps);
+    }
+    reserveParticles(driver.particles, driver.capacity);
+    reserveSleep(driver.sleeping, driver.particles.capacity);
+    reservePositions(driver.renderPositions, driver.particles.capacity);
+    wakeAll(driver.sleeping, driver.particles);
+    startProfiling(driver.profileOptions);
+    return true;
+}
+
+// Writes the recording and trace, if any, and releases the loaded snapshot.
+template <typename Scene>
+bool finishDriver(ParticleDriver<Scene>& driver) {
+    bool saved = finishRecording(driver);
+    saved = finishProfiling(driver.profileOptions) && saved;
+    unmapSnapshot(driver.loadedSnapshot);
+    return saved;
+}
+
+// Draws the overlay if asked for, then shows the frame.
+template <typename Scene>
+void presentFrame(ParticleDriver<Scene>& driver, GLFWwindow* window) {
+    if (driver.profileOptions.overlay) {
+        collectProfile(driver.profileOverlay);
+        drawProfileOverlay(driver.profileOverlay);
+    }
+    if (driver.outputOptions.path) {
+        ProfileScope scope("readback");
+        submitFrame(driver.frameOutput);
+    } else {
+        ProfileScope scope("swap");
+        glfwSwapBuffers(window);
+    }
+}
+
+// Pipelined mode: runs ticks as they fall due, publishing the state after each
+// batch, and sleeps until the next tick.
+template <typename Scene>
+void simulationLoop(ParticleDriver<Scene>& driver) {
+    FixedStep& clock = driver.fixedStep;
+    while (driver.simulationRunning.load(std::memory_order_acquire)) {
+        InputMessage message;
+        while (pop(driver.inputQueue, message)) applyInput(driver, message);
+
+        double now = glfwGetTime();
+        int ticks = consumeTicks(clock, now);
+        for (int tick = 0; tick < ticks; ++tick) {
+            savePositions(driver.renderPositions, driver.particles);
+            runTick(driver, tickDt(clock));
+        }
+        if (ticks > 0) {
+            captureFrame(backSlot(driver.frames), driver.renderPositions, driver.particles, now - clock.accumulator);
+            publish(driver.frames);
+        }
+        std::this_thread::sleep_for(std::chrono::duration<double>(tickDt(clock) - clock.accumulator));
+    }
+}
+
+// Runs the window until it is closed or the --output frames are written, with
+// the physics on its own thread if pipelined. draw(time, positions) renders a
+// frame. Call once the GL context is current; returns false if the output
+// could not be written.
+template <typename Scene, typename Draw>
+bool runWindow(ParticleDriver<Scene>& driver, GLFWwindow* window, Draw&& draw) {
+    FixedStep& clock = driver.fixedStep;
+    if (driver.outputOptions.path) {
+        int width, height;
+        glfwGetFramebufferSize(window, &width, &height);
+        if (!beginFrameOutput(driver.frameOutput, driver.outputOptions, width, height)) return false;
+        // Output frames follow their own clock on this thread.
+        driver.pipelined = false;
+        allowFrameTime(clock, 1.0 / driver.outputOptions.fps);
+    }
+    startRecording(driver, tickDt(clock));
+
+    if (driver.pipelined) {
+        // The physics thread owns the simulation state until it is joined.
+        const double rate = clock.rate;
+        for (ParticleFrame& frame : driver.frames.slots) reserveFrame(frame, driver.particles.capacity);
+        driver.simulationRunning.store(true, std::memory_order_release);
+        std::thread simulation([&driver] { simulationLoop(driver); });
+        while (!glfwWindowShouldClose(window)) {
+            acquire(driver.frames);
+            ParticleFrame& frame = frontSlot(driver.frames);
+            double now = glfwGetTime();
+            float alpha = static_cast<float>(std::max(0.0, std::min((now - frame.tickTime) * rate, 1.0)));
+            blendPositions(frame.positions, frame.posX, frame.posY, alpha);
+            draw(static_cast<float>(now), frame.positions);
+            presentFrame(driver, window);
+            glfwPollEvents();
+        }
+        driver.simulationRunning.store(false, std::memory_order_release);
+        simulation.join();
+    }
+
+    while (!driver.pipelined && !glfwWindowShouldClose(window)) {
+        double now = driver.outputOptions.path ? outputTime(driver.outputOptions, driver.frameOutput.submitted)
+                                               : glfwGetTime();
+        int ticks = consumeTicks(clock, now);
+        for (int tick = 0; tick < ticks; ++tick) {
+            savePositions(driver.renderPositions, driver.particles);
+            runTick(driver, tickDt(clock));
+        }
+        blendPositions(driver.renderPositions, driver.particles, interpolationAlpha(clock));
+        draw(static_cast<float>(now), driver.renderPositions);
+        presentFrame(driver, window);
+        glfwPollEvents();
+        if (driver.outputOptions.path && outputComplete(driver.frameOutput, driver.outputOptions)) break;
+    }
+    return finishFrameOutput(driver.frameOutput, driver.outputOptions);
+}
@@ -0,0 +1,225 @@
+#pragma once
+
+// Sleeping for the particle programs. Particles [0, awakeCount) are awake and
+// the rest asleep. Sleepers are not integrated and collide only as immovable
+// obstacles, so a substep costs roughly the number of awake particles. Once per
+// tick, particles that have barely moved for SLEEP_TICKS are grouped into
+// contact islands with a union-find, and an island whose members have all
+// rested goes to sleep as a whole. An awake particle running into a sleeper
+// fast enough wakes that sleeper's whole island.
+//
+// Each program keeps its own broadphase, so the functions that need neighbours
+// take them as visitors: ownedNeighbors(i, reach, visit) calls visit(j) once
+// for every awake pair (i, j) within reach, and sleepingNeighbors(i, visit)
+// calls visit(j) for every sleeper j that might touch awake particle i. Rest
+// counters and island labels are per pool slot, so they follow a particle
+// wherever the arrays move it.
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include "particle_store.h"
+
+const float SLEEP_SPEED = 0.05f; // displacement per second below which a particle rests
+const uint16_t SLEEP_TICKS = 30; // ticks every member of an island must rest to sleep
+const float WAKE_SPEED = 0.5f;   // approach speed into a sleeper that wakes its island
+const uint32_t NO_ISLAND = UINT32_MAX;
+
+struct ParticleSleep {
+    bool enabled = true;
+    int awakeCount = 0;
+    bool sleepersChanged = false; // the sleeping range changed since the program last indexed it
+    std::vector<uint16_t> restTicks;   // per slot
+    std::vector<uint32_t> sleepIsland; // per slot, while asleep
+    uint32_t nextIsland = 0;
+    std::vector<int> islandParent;     // union-find over awake particles
+    std::vector<uint16_t> islandRest;
+    std::vector<uint32_t> islandLabel;
+    std::vector<std::pair<uint32_t, uint32_t>> islandMerges;
+    std::vector<uint32_t> wakeRequests;
+};
+
+inline void reserveSleep(ParticleSleep& sleep, std::size_t capacity) {
+    sleep.restTicks.assign(capacity, 0);
+    sleep.sleepIsland.assign(capacity, NO_ISLAND);
+    sleep.islandParent.reserve(capacity);
+    sleep.islandRest.reserve(capacity);
+    sleep.islandLabel.reserve(capacity);
+}
+
+// Moves particle i to the front of the sleeping range and makes it awake.
+inline void wakeParticle(ParticleSleep& sleep, ParticleStore& store, int i, RenderPositions* render) {
+    swapParticles(store, i, sleep.awakeCount, render);
+    sleep.restTicks[store.slotOf[sleep.awakeCount]] = 0;
+    sleep.awakeCount++;
+    sleep.sleepersChanged = true;
+}
+
+// Wakes every sleeping particle of the islands in wakeRequests.
+inline void wakeIslands(ParticleSleep& sleep, ParticleStore& store, RenderPositions* render) {
+    if (sleep.wakeRequests.empty()) return;
+    const std::vector<uint32_t>& islands = sleep.wakeRequests;
+    for (int i = sleep.awakeCount; i < static_cast<int>(store.size()); ++i) {
+        uint32_t island = sleep.sleepIsland[store.slotOf[i]];
+        if (std::find(islands.begin(), islands.end(), island) != islands.end()) wakeParticle(sleep, store, i, render);
+    }
+}
+
+inline void wakeAll(ParticleSleep& sleep, const ParticleStore& store) {
+    sleep.awakeCount = static_cast<int>(store.size());
+    std::fill(sleep.restTicks.begin(), sleep.restTicks.end(), 0);
+    sleep.sleepersChanged = true;
+}
+
+// Sleeping particles are immovable. An awake particle that touches one is
+// pushed clear of it, unless it is moving into it fast enough to wake its
+// island, in which case the contact is resolved normally from the next substep.
+template <typename SleepingNeighbors>
+void collideSleepers(ParticleSleep& sleep, ParticleStore& store, RenderPositions* render, float radiusSum, float dt,
+                     SleepingNeighbors&& sleepingNeighbors, long long& pairTests, long long& contacts) {
+    sleep.wakeRequests.clear();
+    if (sleep.awakeCount == static_cast<int>(store.size())) return;
+    for (int i = 0; i < sleep.awakeCount; ++i) {
+        sleepingNeighbors(i, [&](int j) {
+            pairTests++;
+            float dx = store.posX[j] - store.posX[i];
+            float dy = store.posY[j] - store.posY[i];
+            float distanceSquared = dx * dx + dy * dy;
+            if (distanceSquared >= radiusSum * radiusSum || distanceSquared <= 0.0f) return;
+            contacts++;
+            float distance = std::sqrt(distanceSquared);
+            float nx = dx / distance;
+            float ny = dy / distance;
+            float approach = ((store.posX[i] - store.lastPosX[i]) * nx +
+                              (store.posY[i] - store.lastPosY[i]) * ny) / dt;
+            if (approach > WAKE_SPEED) {
+                uint32_t island = sleep.sleepIsland[store.slotOf[j]];
+                if (std::find(sleep.wakeRequests.begin(), sleep.wakeRequests.end(), island) == sleep.wakeRequests.end()) {
+                    sleep.wakeRequests.push_back(island);
+                }
+            } else {
+                float overlap = radiusSum - distance;
+                store.posX[i] -= nx * overlap;
+                store.posY[i] -= ny * overlap;
+            }
+        });
+    }
+    wakeIslands(sleep, store, render);
+}
+
+// Counts how long each awake particle has been at rest; returns whether any
+// has rested long enough to sleep.
+inline bool updateRest(ParticleSleep& sleep, const ParticleStore& store, float substepDt) {
+    const float restLimit = SLEEP_SPEED * substepDt;
+    bool candidates = false;
+    for (int i = 0; i < sleep.awakeCount; ++i) {
+        float dx = store.posX[i] - store.lastPosX[i];
+        float dy = store.posY[i] - store.lastPosY[i];
+        uint16_t& rest = sleep.restTicks[store.slotOf[i]];
+        if (dx * dx + dy * dy < restLimit * restLimit) {
+            if (rest < UINT16_MAX) rest++;
+            candidates = candidates || rest >= SLEEP_TICKS;
+        } else {
+            rest = 0;
+        }
+    }
+    return candidates;
+}
+
+inline int findIsland(ParticleSleep& sleep, int i) {
+    while (sleep.islandParent[i] != i) {
+        sleep.islandParent[i] = sleep.islandParent[sleep.islandParent[i]];
+        i = sleep.islandParent[i];
+    }
+    return i;
+}
+
+// Groups the awake particles into islands of particles within `reach` of each
+// other and puts to sleep every island whose members have all rested for
+// SLEEP_TICKS. An island that falls asleep against sleeping ones joins them, so
+// they wake together. Both visitors must reflect the current positions.
+template <typename OwnedNeighbors, typename SleepingNeighbors>
+void sleepIslands(ParticleSleep& sleep, ParticleStore& store, RenderPositions* render, float reach,
+                  OwnedNeighbors&& ownedNeighbors, SleepingNeighbors&& sleepingNeighbors) {
+    const int awake = sleep.awakeCount;
+    sleep.islandParent.resize(awake);
+    for (int i = 0; i < awake; ++i) sleep.islandParent[i] = i;
+    for (int i = 0; i < awake; ++i) {
+        ownedNeighbors(i, reach, [&](int j) {
+            float dx = store.posX[j] - store.posX[i];
+            float dy = store.posY[j] - store.posY[i];
+            if (dx * dx + dy * dy >= reach * reach) return;
+            int a = findIsland(sleep, i), b = findIsland(sleep, j);
+            if (a != b) sleep.islandParent[std::max(a, b)] = std::min(a, b);
+        });
+    }
+
+    // Per root: the shortest rest of any member and the sleeping island it
+    // touches, if any. Further sleeping islands it touches are merged into that one.
+    sleep.islandRest.assign(awake, UINT16_MAX);
+    sleep.islandLabel.assign(awake, NO_ISLAND);
+    sleep.islandMerges.clear();
+    for (int i = 0; i < awake; ++i) {
+        int root = findIsland(sleep, i);
+        sleep.islandRest[root] = std::min(sleep.islandRest[root], sleep.restTicks[store.slotOf[i]]);
+    }
+    for (int i = 0; i < awake; ++i) {
+        int root = findIsland(sleep, i);
+        if (sleep.islandRest[root] < SLEEP_TICKS) continue;
+        sleepingNeighbors(i, [&](int j) {
+            float dx = store.posX[j] - store.posX[i];
+            float dy = store.posY[j] - store.posY[i];
+            if (dx * dx + dy * dy >= reach * reach) return;
+            uint32_t touched = sleep.sleepIsland[store.slotOf[j]];
+            if (sleep.islandLabel[root] == NO_ISLAND) {
+                sleep.islandLabel[root] = touched;
+            } else if (touched != sleep.islandLabel[root]) {
+                sleep.islandMerges.push_back({ touched, sleep.islandLabel[root] });
+            }
+        });
+    }
+
+    bool slept = false;
+    for (int i = awake - 1; i >= 0; --i) {
+        int root = findIsland(sleep, i);
+        if (sleep.islandRest[root] < SLEEP_TICKS) continue;
+        if (sleep.islandLabel[root] == NO_ISLAND) sleep.islandLabel[root] = sleep.nextIsland++;
+        sleep.sleepIsland[store.slotOf[i]] = sleep.islandLabel[root];
+        store.lastPosX[i] = store.posX[i];
+        store.lastPosY[i] = store.posY[i];
+        store.velX[i] = 0.0f;
+        store.velY[i] = 0.0f;
+        // i's union-find entry is no longer needed once it moves; the particle
+        // swapped into i has already been visited.
+        swapParticles(store, i, sleep.awakeCount - 1, render);
+        sleep.awakeCount--;
+        slept = true;
+    }
+    for (const auto& merge : sleep.islandMerges) {
+        for (std::size_t i = sleep.awakeCount; i < store.size(); ++i) {
+            uint32_t& island = sleep.sleepIsland[store.slotOf[i]];
+            if (island == merge.first) island = merge.second;
+        }
+    }
+    if (slept) sleep.sleepersChanged = true;
+}
+
+// Compacts away particles expireParticles() marked. A removed sleeper may be
+// holding others up, so its island wakes first. Compaction moves the sleepers
+// down, so they need indexing again.
+inline void compactSleeping(ParticleSleep& sleep, ParticleStore& store, RenderPositions* render) {
+    if (store.deadCount == 0) return;
+    sleep.wakeRequests.clear();
+    for (std::size_t i = sleep.awakeCount; i < store.size(); ++i) {
+        if (store.dead[i]) sleep.wakeRequests.push_back(sleep.sleepIsland[store.slotOf[i]]);
+    }
+    wakeIslands(sleep, store, render);
+    int removedAwake = 0;
+    for (int i = 0; i < sleep.awakeCount; ++i) removedAwake += store.dead[i];
+    sleep.awakeCount -= removedAwake;
+    compactParticles(store, render);
+    sleep.sleepersChanged = true;
+}
@@ -0,0 +1,537 @@
+#pragma once
+
+// Structure-of-arrays particle storage and the vectorized kernels that
+// integrate it. Each kernel is written once against a small lane type and
+// instantiated for the widest instruction set the compiler targets (AVX, SSE2
+// or NEON), with the scalar lane type handling the tail. Build with
+// -march=native (or -mavx) to get the 8-wide path on x86.
+//
+// The arrays are a fixed-capacity pool: reserveParticles() sizes them once, and
+// spawning past the capacity fails rather than reallocating. Live particles
+// always occupy [0, size()) so the kernels run over dense arrays. Anything
+// that must refer to a particle across ticks holds a ParticleHandle, which
+// stays valid while the particle moves within the arrays and is recognised as
+// stale once the particle is removed.
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <vector>
+
+#if defined(__AVX__) || defined(__SSE2__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+template <typename T, std::size_t Alignment>
+struct AlignedAllocator {
+    using value_type = T;
+    template <typename U> struct rebind { using other = AlignedAllocator<U, Alignment>; };
+
+    AlignedAllocator() = default;
+    template <typename U> AlignedAllocator(const AlignedAllocator<U, Alignment>&) {}
+
+    T* allocate(std::size_t n) {
+        return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(Alignment)));
+    }
+    void deallocate(T* p, std::size_t) {
+        ::operator delete(p, std::align_val_t(Alignment));
+    }
+
+    template <typename U> bool operator==(const AlignedAllocator<U, Alignment>&) const { return true; }
+    template <typename U> bool operator!=(const AlignedAllocator<U, Alignment>&) const { return false; }
+};
+
+// Cache-line aligned, so every array starts on a full vector boundary.
+using FloatArray = std::vector<float, AlignedAllocator<float, 64>>;
+
+// A slot in the pool and the generation the slot had when the particle was
+// spawned. Removing a particle bumps its slot's generation before the slot
+// goes back on the free list.
+struct ParticleHandle {
+    uint32_t slot = UINT32_MAX;
+    uint32_t generation = 0;
+};
+
+struct ParticleStore {
+    FloatArray posX, posY;
+    FloatArray lastPosX, lastPosY;
+    FloatArray velX, velY;
+    FloatArray birth; // simulated time each particle was spawned
+
+    std::size_t capacity = 0;
+    std::vector<uint32_t> slotOf;     // slot of each particle
+    std::vector<uint32_t> indexOf;    // particle index of each occupied slot
+    std::vector<uint32_t> generation; // per slot
+    std::vector<uint32_t> freeSlots;  // popped from the back
+    std::vector<uint8_t> dead;        // removed, waiting for compactParticles()
+    std::size_t deadCount = 0;
+
+    std::size_t size() const { return posX.size(); }
+};
+
+// Sizes every array for `capacity` particles (at least the ones already
+// stored, which get the first slots). Call before spawning or simulating; the
+// only allocations the pool makes happen here.
+inline void reserveParticles(ParticleStore& store, std::size_t capacity) {
+    const std::size_t count = store.size();
+    capacity = std::max(capacity, count);
+    store.capacity = capacity;
+    FloatArray* arrays[7] = { &store.posX, &store.posY, &store.lastPosX, &store.lastPosY,
+                              &store.velX, &store.velY, &store.birth };
+    for (FloatArray* array : arrays) array->reserve(capacity);
+    store.birth.resize(count, 0.0f);
+    store.slotOf.reserve(capacity);
+    store.slotOf.resize(count);
+    store.indexOf.assign(capacity, 0);
+    store.generation.assign(capacity, 0);
+    store.dead.reserve(capacity);
+    store.dead.assign(count, 0);
+    store.deadCount = 0;
+    for (std::size_t i = 0; i < count; ++i) {
+        store.slotOf[i] = static_cast<uint32_t>(i);
+        store.indexOf[i] = static_cast<uint32_t>(i);
+    }
+    store.freeSlots.clear();
+    store.freeSlots.reserve(capacity);
+    for (std::size_t slot = capacity; slot > count; --slot) {
+        store.freeSlots.push_back(static_cast<uint32_t>(slot - 1));
+    }
+}
+
+inline bool validHandle(const ParticleHandle& handle) {
+    return handle.slot != UINT32_MAX;
+}
+
+// Appends a particle at rest; returns an invalid handle if the pool is full.
+inline ParticleHandle addParticle(ParticleStore& store, float x, float y, float time = 0.0f) {
+    if (store.freeSlots.empty()) return ParticleHandle();
+    uint32_t slot = store.freeSlots.back();
+    store.freeSlots.pop_back();
+    store.indexOf[slot] = static_cast<uint32_t>(store.size());
+    store.slotOf.push_back(slot);
+    store.dead.push_back(0);
+    store.posX.push_back(x);
+    store.posY.push_back(y);
+    store.lastPosX.push_back(x);
+    store.lastPosY.push_back(y);
+    store.velX.push_back(0.0f);
+    store.velY.push_back(0.0f);
+    store.birth.push_back(time);
+    return { slot, store.generation[slot] };
+}
+
+inline ParticleHandle particleHandle(const ParticleStore& store, std::size_t index) {
+    uint32_t slot = store.slotOf[index];
+    return { slot, store.generation[slot] };
+}
+
+// Current index of a particle, or SIZE_MAX if it has been removed.
+inline std::size_t particleIndex(const ParticleStore& store, const ParticleHandle& handle) {
+    if (handle.slot >= store.capacity || store.generation[handle.slot] != handle.generation) return SIZE_MAX;
+    std::size_t index = store.indexOf[handle.slot];
+    return store.dead[index] ? SIZE_MAX : index;
+}
+
+// Removal is deferred: the particle stays in the arrays, still simulated,
+// until the next compactParticles().
+inline void removeParticleAt(ParticleStore& store, std::size_t index) {
+    if (store.dead[index]) return;
+    store.dead[index] = 1;
+    store.deadCount++;
+}
+
+inline bool removeParticle(ParticleStore& store, const ParticleHandle& handle) {
+    std::size_t index = particleIndex(store, handle);
+    if (index == SIZE_MAX) return false;
+    removeParticleAt(store, index);
+    return true;
+}
+
+// Marks particles older than `lifetime` seconds (if positive), non-finite, or
+// further than `reach` from the origin on either axis; returns how many.
+inline std::size_t expireParticles(ParticleStore& store, float time, float lifetime, float reach) {
+    const std::size_t before = store.deadCount;
+    for (std::size_t i = 0; i < store.size(); ++i) {
+        float x = store.posX[i];
+        float y = store.posY[i];
+        bool expired = lifetime > 0.0f && time - store.birth[i] >= lifetime;
+        bool lost = !(std::fabs(x) <= reach && std::fabs(y) <= reach); // also catches NaN
+        if (expired || lost) removeParticleAt(store, i);
+    }
+    return store.deadCount - before;
+}
+
+// Lane types. Each provides width, load/store/splat, arithmetic operators,
+// comparisons returning a Mask, select(mask, ifSet, ifClear) and sqrt.
+
+struct ScalarLanes {
+    static const int width = 1;
+    using Mask = bool;
+    float v;
+
+    static ScalarLanes load(const float* p) { return { *p }; }
+    static ScalarLanes splat(float x) { return { x }; }
+    void store(float* p) const { *p = v; }
+};
+
+inline ScalarLanes operator+(ScalarLanes a, ScalarLanes b) { return { a.v + b.v }; }
+inline ScalarLanes operator-(ScalarLanes a, ScalarLanes b) { return { a.v - b.v }; }
+inline ScalarLanes operator*(ScalarLanes a, ScalarLanes b) { return { a.v * b.v }; }
+inline ScalarLanes operator/(ScalarLanes a, ScalarLanes b) { return { a.v / b.v }; }
+inline bool lessThan(ScalarLanes a, ScalarLanes b) { return a.v < b.v; }
+inline ScalarLanes select(bool m, ScalarLanes a, ScalarLanes b) { return m ? a : b; }
+inline ScalarLanes sqrt(ScalarLanes a) { return { std::sqrt(a.v) }; }
+
+#if defined(__AVX__)
+struct AvxLanes {
+    static const int width = 8;
+    struct Mask { __m256 m; };
+    __m256 v;
+
+    static AvxLanes load(const float* p) { return { _mm256_loadu_ps(p) }; }
+    static AvxLanes splat(float x) { return { _mm256_set1_ps(x) }; }
+    void store(float* p) const { _mm256_storeu_ps(p, v); }
+};
+
+inline AvxLanes operator+(AvxLanes a, AvxLanes b) { return { _mm256_add_ps(a.v, b.v) }; }
+inline AvxLanes operator-(AvxLanes a, AvxLanes b) { return { _mm256_sub_ps(a.v, b.v) }; }
+inline AvxLanes operator*(AvxLanes a, AvxLanes b) { return { _mm256_mul_ps(a.v, b.v) }; }
+inline AvxLanes operator/(AvxLanes a, AvxLanes b) { return { _mm256_div_ps(a.v, b.v) }; }
+inline AvxLanes::Mask lessThan(AvxLanes a, AvxLanes b) { return { _mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ) }; }
+inline AvxLanes select(AvxLanes::Mask m, AvxLanes a, AvxLanes b) { return { _mm256_blendv_ps(b.v, a.v, m.m) }; }
+inline AvxLanes sqrt(AvxLanes a) { return { _mm256_sqrt_ps(a.v) }; }
+
+using SimdLanes = AvxLanes;
+#elif defined(__SSE2__)
+struct SseLanes {
+    static const int width = 4;
+    struct Mask { __m128 m; };
+    __m128 v;
+
+    static SseLanes load(const float* p) { return { _mm_loadu_ps(p) }; }
+    static SseLanes splat(float x) { return { _mm_set1_ps(x) }; }
+    void store(float* p) const { _mm_storeu_ps(p, v); }
+};
+
+inline SseLanes operator+(SseLanes a, SseLanes b) { return { _mm_add_ps(a.v, b.v) }; }
+inline SseLanes operator-(SseLanes a, SseLanes b) { return { _mm_sub_ps(a.v, b.v) }; }
+inline SseLanes operator*(SseLanes a, SseLanes b) { return { _mm_mul_ps(a.v, b.v) }; }
+inline SseLanes operator/(SseLanes a, SseLanes b) { return { _mm_div_ps(a.v, b.v) }; }
+inline SseLanes::Mask lessThan(SseLanes a, SseLanes b) { return { _mm_cmplt_ps(a.v, b.v) }; }
+inline SseLanes select(SseLanes::Mask m, SseLanes a, SseLanes b) {
+    return { _mm_or_ps(_mm_and_ps(m.m, a.v), _mm_andnot_ps(m.m, b.v)) };
+}
+inline SseLanes sqrt(SseLanes a) { return { _mm_sqrt_ps(a.v) }; }
+
+using SimdLanes = SseLanes;
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+struct NeonLanes {
+    static const int width = 4;
+    struct Mask { uint32x4_t m; };
+    float32x4_t v;
+
+    static NeonLanes load(const float* p) { return { vld1q_f32(p) }; }
+    static NeonLanes splat(float x) { return { vdupq_n_f32(x) }; }
+    void store(float* p) const { vst1q_f32(p, v); }
+};
+
+inline NeonLanes operator+(NeonLanes a, NeonLanes b) { return { vaddq_f32(a.v, b.v) }; }
+inline NeonLanes operator-(NeonLanes a, NeonLanes b) { return { vsubq_f32(a.v, b.v) }; }
+inline NeonLanes operator*(NeonLanes a, NeonLanes b) { return { vmulq_f32(a.v, b.v) }; }
+inline NeonLanes operator/(NeonLanes a, NeonLanes b) { return { vdivq_f32(a.v, b.v) }; }
+inline NeonLanes::Mask lessThan(NeonLanes a, NeonLanes b) { return { vcltq_f32(a.v, b.v) }; }
+inline NeonLanes select(NeonLanes::Mask m, NeonLanes a, NeonLanes b) { return { vbslq_f32(m.m, a.v, b.v) }; }
+inline NeonLanes sqrt(NeonLanes a) { return { vsqrtq_f32(a.v) }; }
+
+using SimdLanes = NeonLanes;
+#else
+using SimdLanes = ScalarLanes;
+#endif
+
+// Runs kernel<Lanes>(i) over [0, n): full vectors first, then the scalar tail.
+template <template <typename> class Kernel, typename... Args>
+inline void forEachLane(std::size_t n, Args&&... args) {
+    const std::size_t vectorEnd = n - n % SimdLanes::width;
+    std::size_t i = 0;
+    for (; i < vectorEnd; i += SimdLanes::width) {
+        Kernel<SimdLanes>::run(i, args...);
+    }
+    for (; i < n; ++i) {
+        Kernel<ScalarLanes>::run(i, args...);
+    }
+}
+
+// Verlet step of one axis. Acceleration is accel + velAccel * vel, which covers
+// constant gravity and linear damping.
+template <typename L>
+struct VerletKernel {
+    static void run(std::size_t i, float* pos, float* lastPos, const float* vel,
+                    float accel, float velAccel, float dt) {
+        L p = L::load(pos + i);
+        L a = L::splat(accel) + L::splat(velAccel) * L::load(vel + i);
+        L next = L::splat(2.0f) * p - L::load(lastPos + i) + a * L::splat(dt * dt);
+        p.store(lastPos + i);
+        next.store(pos + i);
+    }
+};
+
+template <typename L>
+struct VelocityKernel {
+    static void run(std::size_t i, const float* pos, const float* lastPos, float* vel, float invDt) {
+        L v = (L::load(pos + i) - L::load(lastPos + i)) * L::splat(invDt);
+        v.store(vel + i);
+    }
+};
+
+// Clamps one axis to [low, high], reversing the velocity of clamped particles.
+template <typename L>
+struct WallKernel {
+    static void run(std::size_t i, float* pos, float* vel, float low, float high) {
+        L p = L::load(pos + i);
+        L v = L::load(vel + i);
+        L lo = L::splat(low);
+        L hi = L::splat(high);
+        L flipped = L::splat(0.0f) - v;
+
+        auto below = lessThan(p, lo);
+        p = select(below, lo, p);
+        v = select(below, flipped, v);
+        auto above = lessThan(hi, p);
+        p = select(above, hi, p);
+        v = select(above, flipped, v);
+
+        p.store(pos + i);
+        v.store(vel + i);
+    }
+};
+
+// Pulls particles that poke through the circular bowl back inside, and
+// reflects and damps their velocity about the outward normal.
+template <typename L>
+struct BowlKernel {
+    static void run(std::size_t i, float* posX, float* posY, float* velX, float* velY,
+                    float bowlRadius, float ballRadius, float restitution) {
+        L x = L::load(posX + i);
+        L y = L::load(posY + i);
+        L vx = L::load(velX + i);
+        L vy = L::load(velY + i);
+
+        L distance = sqrt(x * x + y * y);
+        L reach = distance + L::splat(ballRadius);
+        auto outside = lessThan(L::splat(bowlRadius), reach);
+
+        L overlap = reach - L::splat(bowlRadius);
+        L factor = distance / (distance + overlap);
+        L newX = x * factor;
+        L newY = y * factor;
+        L nx = newX / distance;
+        L ny = newY / distance;
+        L dot = vx * nx + vy * ny;
+        L two = L::splat(2.0f);
+        L newVx = (vx - two * dot * nx) * L::splat(restitution);
+        L newVy = (vy - two * dot * ny) * L::splat(restitution);
+
+        select(outside, newX, x).store(posX + i);
+        select(outside, newY, y).store(posY + i);
+        select(outside, newVx, vx).store(velX + i);
+        select(outside, newVy, vy).store(velY + i);
+    }
+};
+
+template <typename L>
+struct LerpKernel {
+    static void run(std::size_t i, const float* from, const float* to, float* out, float alpha) {
+        L a = L::load(from + i);
+        (a + (L::load(to + i) - a) * L::splat(alpha)).store(out + i);
+    }
+};
+
+inline void integrateVerlet(float* pos, float* lastPos, const float* vel,
+                            float accel, float velAccel, float dt, std::size_t n) {
+    forEachLane<VerletKernel>(n, pos, lastPos, vel, accel, velAccel, dt);
+}
+
+inline void deriveVelocity(const float* pos, const float* lastPos, float* vel, float dt, std::size_t n) {
+    forEachLane<VelocityKernel>(n, pos, lastPos, vel, 1.0f / dt);
+}
+
+inline void clampToWalls(float* pos, float* vel, float low, float high, std::size_t n) {
+    forEachLane<WallKernel>(n, pos, vel, low, high);
+}
+
+inline void clampToBowl(float* posX, float* posY, float* velX, float* velY,
+                        float bowlRadius, float ballRadius, float restitution, std::size_t n) {
+    forEachLane<BowlKernel>(n, posX, posY, velX, velY, bowlRadius, ballRadius, restitution);
+}
+
+// Positions blended between the start of the last physics tick and its end, so
+// rendering stays smooth when the display and physics rates differ.
+struct RenderPositions {
+    FloatArray prevX, prevY;
+    FloatArray x, y;
+};
+
+// Closes the gaps left by removed particles, keeping the survivors in order,
+// and frees their slots. Arrays only shrink, so no memory is released or
+// allocated. `render`'s saved positions are compacted the same way so the
+// next blend still pairs each particle with its own previous position.
+inline void compactParticles(ParticleStore& store, RenderPositions* render = nullptr) {
+    if (store.deadCount == 0) return;
+    const std::size_t count = store.size();
+    const std::size_t saved = render ? std::min(render->prevX.size(), count) : 0;
+    std::size_t kept = 0, keptSaved = 0;
+    for (std::size_t i = 0; i < count; ++i) {
+        uint32_t slot = store.slotOf[i];
+        if (store.dead[i]) {
+            store.generation[slot]++;
+            store.freeSlots.push_back(slot);
+            continue;
+        }
+        if (i < saved) {
+            render->prevX[keptSaved] = render->prevX[i];
+            render->prevY[keptSaved] = render->prevY[i];
+            keptSaved++;
+        }
+        store.posX[kept] = store.posX[i];
+        store.posY[kept] = store.posY[i];
+        store.lastPosX[kept] = store.lastPosX[i];
+        store.lastPosY[kept] = store.lastPosY[i];
+        store.velX[kept] = store.velX[i];
+        store.velY[kept] = store.velY[i];
+        store.birth[kept] = store.birth[i];
+        store.slotOf[kept] = slot;
+        store.indexOf[slot] = static_cast<uint32_t>(kept);
+        kept++;
+    }
+    FloatArray* arrays[7] = { &store.posX, &store.posY, &store.lastPosX, &store.lastPosY,
+                              &store.velX, &store.velY, &store.birth };
+    for (FloatArray* array : arrays) array->resize(kept);
+    store.slotOf.resize(kept);
+    store.dead.assign(kept, 0);
+    store.deadCount = 0;
+    if (render) {
+        render->prevX.resize(keptSaved);
+        render->prevY.resize(keptSaved);
+    }
+}
+
+// Exchanges particles i and j in every array; their handles follow them. A
+// saved render position that ends up belonging to a particle that had none
+// (one spawned this tick) is set to where that particle is now.
+inline void swapParticles(ParticleStore& store, std::size_t i, std::size_t j, RenderPositions* render = nullptr) {
+    if (i == j) return;
+    FloatArray* arrays[7] = { &store.posX, &store.posY, &store.lastPosX, &store.lastPosY,
+                              &store.velX, &store.velY, &store.birth };
+    for (FloatArray* array : arrays) std::swap((*array)[i], (*array)[j]);
+    std::swap(store.slotOf[i], store.slotOf[j]);
+    std::swap(store.dead[i], store.dead[j]);
+    store.indexOf[store.slotOf[i]] = static_cast<uint32_t>(i);
+    store.indexOf[store.slotOf[j]] = static_cast<uint32_t>(j);
+    if (!render) return;
+    const std::size_t saved = render->prevX.size();
+    if (i < saved && j < saved) {
+        std::swap(render->prevX[i], render->prevX[j]);
+        std::swap(render->prevY[i], render->prevY[j]);
+    } else if (i < saved || j < saved) {
+        std::size_t k = i < saved ? i : j;
+        render->prevX[k] = store.posX[k];
+        render->prevY[k] = store.posY[k];
+    }
+}
+
+// Scratch buffers for permuteParticles(), kept between calls.
+struct PermuteScratch {
+    FloatArray values;
+    std::vector<uint32_t> words;
+};
+
+// Reorders particles [0, order.size()) so the one at order[k] moves to k.
+// Handles and saved render positions follow, as in swapParticles().
+inline void permuteParticles(ParticleStore& store, const std::vector<uint32_t>& order, PermuteScratch& scratch,
+                             RenderPositions* render = nullptr) {
+    const std::size_t count = order.size();
+    FloatArray& values = scratch.values;
+    std::vector<uint32_t>& words = scratch.words;
+    values.resize(count);
+    words.resize(count);
+    if (render) {
+        const std::size_t saved = render->prevX.size();
+        FloatArray* prev[2] = { &render->prevX, &render->prevY };
+        const FloatArray* now[2] = { &store.posX, &store.posY };
+        for (int axis = 0; axis < 2; ++axis) {
+            for (std::size_t k = 0; k < count; ++k) {
+                values[k] = order[k] < saved ? (*prev[axis])[order[k]] : (*now[axis])[order[k]];
+            }
+            std::copy(values.begin(), values.begin() + std::min(count, saved), prev[axis]->begin());
+        }
+    }
+    FloatArray* arrays[7] = { &store.posX, &store.posY, &store.lastPosX, &store.lastPosY,
+                              &store.velX, &store.velY, &store.birth };
+    for (FloatArray* array : arrays) {
+        for (std::size_t k = 0; k < count; ++k) values[k] = (*array)[order[k]];
+        std::copy(values.begin(), values.end(), array->begin());
+    }
+    for (std::size_t k = 0; k < count; ++k) words[k] = store.slotOf[order[k]];
+    for (std::size_t k = 0; k < count; ++k) {
+        store.slotOf[k] = words[k];
+        store.indexOf[words[k]] = static_cast<uint32_t>(k);
+    }
+    for (std::size_t k = 0; k < count; ++k) words[k] = store.dead[order[k]];
+    std::copy(words.begin(), words.end(), store.dead.begin());
+}
+
+// The blend buffers only ever hold as many particles as the store.
+inline void reservePositions(RenderPositions& render, std::size_t capacity) {
+    FloatArray* arrays[4] = { &render.prevX, &render.prevY, &render.x, &render.y };
+    for (FloatArray* array : arrays) array->reserve(capacity);
+}
+
+inline void savePositions(RenderPositions& render, const ParticleStore& store) {
+    render.prevX.assign(store.posX.begin(), store.posX.end());
+    render.prevY.assign(store.posY.begin(), store.posY.end());
+}
+
+// Blends from the saved positions towards posX/posY. Particles spawned since
+// the last save have no previous position and are drawn where they are.
+inline void blendPositions(RenderPositions& render, const FloatArray& posX, const FloatArray& posY, float alpha) {
+    const std::size_t count = posX.size();
+    const std::size_t saved = std::min(render.prevX.size(), count);
+    render.x.resize(count);
+    render.y.resize(count);
+    forEachLane<LerpKernel>(saved, render.prevX.data(), posX.data(), render.x.data(), alpha);
+    forEachLane<LerpKernel>(saved, render.prevY.data(), posY.data(), render.y.data(), alpha);
+    std::copy(posX.begin() + saved, posX.end(), render.x.begin() + saved);
+    std::copy(posY.begin() + saved, posY.end(), render.y.begin() + saved);
+}
+
+inline void blendPositions(RenderPositions& render, const ParticleStore& store, float alpha) {
+    blendPositions(render, store.posX, store.posY, alpha);
+}
+
+// A state handed from a simulation thread to a render thread: positions at the
+// start and end of the last tick, and the wall-clock time of the tick boundary
+// it was captured at, from which the blend starts. The render thread blends
+// into positions.x/y of the frame it holds.
+struct ParticleFrame {
+    RenderPositions positions;
+    FloatArray posX, posY;
+    double tickTime = 0.0;
+};
+
+inline void reserveFrame(ParticleFrame& frame, std::size_t capacity) {
+    reservePositions(frame.positions, capacity);
+    frame.posX.reserve(capacity);
+    frame.posY.reserve(capacity);
+}
+
+inline void captureFrame(ParticleFrame& frame, const RenderPositions& render, const ParticleStore& store, double tickTime) {
+    frame.positions.prevX.assign(render.prevX.begin(), render.prevX.end());
+    frame.positions.prevY.assign(render.prevY.begin(), render.prevY.end());
+    frame.posX.assign(store.posX.begin(), store.posX.end());
+    frame.posY.assign(store.posY.begin(), store.posY.end());
+    frame.tickTime = tickTime;
+}
@@ -4,6 +4,16 @@
 #include <cmath>
 #include <algorithm>
 #include <vector>
+#include <random>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include "bench.h"
+#include "circle_renderer.h"
+#include "contact_solver.h"
+#include "particle_driver.h"
+#include "physics_core.h"
+#include "work_pool.h"
 
 // Constants
 const float PI = 3.14159265358979323846f;
@@ -16,26 +26,81 @@ const float damping = 0.2f;
 const float ballRadius = 0.05f;
 const float bowlRadius = 1.0f; // Define the radius of the circular bowl
 
-// Mouse interaction parameters
-bool isDragging = false;
-bool isSpacePressed = false;
-double mouseX = 0.0f, mouseY = 0.0f;
-
-// Particle structure
-struct Particle {
-    float positionX;
-    float positionY;
-    float velocityX;
-    float velocityY;
-    float lastPositionX;
-    float lastPositionY;
-};
+// Damped discs in a bowl
+using BowlScene = ParticleScene<BowlBoundary, DampedGravity>;
+const BowlScene scene = { { bowlRadius, 0.8f }, { g, damping / mass }, ballRadius };
 
-// Particle system
-std::vector<Particle> particles;
+// Spawning, input, ticks, snapshots and the window loop (particle_driver.h).
+// Space spawns a particle at the cursor every PARTICLE_CREATION_INTERVAL, and
+// particles lost further than PARTICLE_REACH from the centre are removed.
+ParticleDriver<BowlScene> driver;
+ParticleStore& particles = driver.particles;
+RenderPositions& renderPositions = driver.renderPositions;
+FixedStep& fixedStep = driver.fixedStep;
+CircleRenderer circles;
 
 const float PARTICLE_CREATION_INTERVAL = 0.1f; // Time interval in seconds
-float lastParticleCreationTime = 0.0f;
+const float PARTICLE_REACH = 2.0f * bowlRadius;
+
+// Contact response (--solver xpbd): by default each touching pair is pushed
+// apart and swaps normal velocities once, as the broadphase finds it. XPBD
+// instead gathers the substep's contacts and solves them together over
+// --iterations projections, on --threads workers, and velocity then follows
+// from the positions.
+enum class ContactResponse {
+    Pairwise,
+    Xpbd
+};
+ContactResponse contactResponse = ContactResponse::Pairwise;
+ContactSolver contactSolver;
+ContactSettings contactSettings;
+StealingPool contactPool;
+const float CONTACT_MARGIN = 1.1f; // gather pairs this close, relative to touching
+long long solverIterations = 0;
+double solverResidual = 0.0;
+
+// Contacts are found and resolved one horizontal stripe at a time, stripes as
+// tall as the contact reach. A pair belongs to the stripe of its lower
+// particle, so resolving stripe r writes only to stripes r and r + 1: all even
+// stripes run in parallel on contactPool (--threads), then all odd ones, with
+// no locks. Stripes keep ascending particle order, so the result does not
+// depend on the thread count or scheduling.
+struct Stripes {
+    int count = 0;
+    float height = 0.0f;
+    std::vector<int> stripeOf; // per particle
+    std::vector<int> start;    // count + 1 offsets into entries
+    std::vector<int> entries;  // particle indices, grouped by stripe
+    std::vector<long long> pairTests, contacts; // per stripe, from the last pass
+};
+Stripes stripes;         // awake particles, rebuilt every substep
+Stripes sleepingStripes; // sleeping particles, rebuilt when they change
+
+// Sweep and prune (--broadphase sap) instead keeps the awake particles
+// themselves sorted by their angle about the bowl's centre, measured from the
+// bottom, so a pile lies along the sweep. A particle's candidates are the ones
+// after it within the angle the contact reach can span at its radius, wrapping
+// round past the top. Particles barely move between substeps, so an insertion
+// sort starting from the previous order does little work, and the integration
+// loops then walk memory in the same order as the sweep. It runs on one
+// thread; the stripes resolve in parallel. Sleepers keep their stripes.
+enum class Broadphase {
+    Stripes,
+    SweepAndPrune
+};
+Broadphase broadphase = Broadphase::Stripes;
+FloatArray sweepAngles; // of the awake particles, in sweep order
+std::vector<uint32_t> sweepOrder;
+PermuteScratch sweepScratch;
+
+// Sleeping (particle_sleep.h), which --no-sleep turns off.
+ParticleSleep& sleeping = driver.sleeping;
+int& awakeCount = sleeping.awakeCount;
+bool settleBench = false; // --settle: benchmark without spawning, so the particles come to rest
+
+// Pair statistics, accumulated for the benchmark report
+long long& pairTests = driver.pairTests;
+long long& contacts = driver.contacts;
 
 void screenToWorld(GLFWwindow* window, double sx, double sy, double& wx, double& wy) {
     int width, height;
@@ -45,90 +110,279 @@ void screenToWorld(GLFWwindow* window, double sx, double sy, double& wx, double&
     wy = -wy; // Invert Y if necessary based on your coordinate system
 }
 
-void verletIntegration(float& position, float& lastPosition, float velocity, float acceleration, float dt) {
-    float nextPosition = 2.0f * position - lastPosition + acceleration * dt * dt;
-    lastPosition = position;
-    position = nextPosition;
+int stripeAt(const Stripes& index, float y) {
+    float stripe = std::floor((y + PARTICLE_REACH) / index.height);
+    return static_cast<int>(std::min(std::max(0.0f, stripe), static_cast<float>(index.count - 1)));
 }
 
-void updatePhysics(float dt) {
+// Sorts particles [begin, end) into the stripes, each listing its particles in
+// ascending order. Particles beyond PARTICLE_REACH (and non-finite ones, until
+// they expire) go in the end stripes, which keeps any two within `height` of
+// each other no more than one stripe apart.
+void buildStripes(Stripes& index, int begin, int end, float height) {
+    index.count = std::max(1, static_cast<int>(std::ceil(2.0f * PARTICLE_REACH / height)));
+    index.height = height;
+    index.stripeOf.resize(end);
+    index.entries.resize(end - begin);
+    index.start.assign(index.count + 1, 0);
+    for (int i = begin; i < end; ++i) {
+        index.stripeOf[i] = stripeAt(index, particles.posY[i]);
+        index.start[index.stripeOf[i] + 1]++;
+    }
+    for (int stripe = 0; stripe < index.count; ++stripe) {
+        index.start[stripe + 1] += index.start[stripe];
+    }
+    for (int i = begin; i < end; ++i) {
+        index.entries[index.start[index.stripeOf[i]]++] = i;
+    }
+    for (int stripe = index.count; stripe > 0; --stripe) {
+        index.start[stripe] = index.start[stripe - 1];
+    }
+    index.start[0] = 0;
+}
 
-    for (auto& particle : particles) {
-        float forceX = -damping * particle.velocityX;
-        float forceY = -g * mass - damping * particle.velocityY;
+// Angle of a position about the bowl's centre, 0 at the bottom and +-PI at the
+// top. Non-finite positions, until they expire, sort to the top.
+float arcAngle(float x, float y) {
+    float angle = std::atan2(x, -y);
+    return std::isfinite(angle) ? angle : PI;
+}
 
-        float accelerationX = forceX / mass;
-        float accelerationY = forceY / mass;
+// Restores angle order of the awake particles after a substep moved them. The
+// insertion sort runs over (angle, index) pairs, and the particles are then
+// moved into the new order in one pass.
+void sortAwakeByAngle() {
+    sweepAngles.resize(awakeCount);
+    sweepOrder.resize(awakeCount);
+    bool sorted = true;
+    for (int i = 0; i < awakeCount; ++i) {
+        float key = arcAngle(particles.posX[i], particles.posY[i]);
+        int j = i;
+        for (; j > 0 && sweepAngles[j - 1] > key; --j) {
+            sweepAngles[j] = sweepAngles[j - 1];
+            sweepOrder[j] = sweepOrder[j - 1];
+        }
+        sweepAngles[j] = key;
+        sweepOrder[j] = static_cast<uint32_t>(i);
+        sorted = sorted && j == i;
+    }
+    if (!sorted) permuteParticles(particles, sweepOrder, sweepScratch, &renderPositions);
+}
 
-        verletIntegration(particle.positionX, particle.lastPositionX, particle.velocityX, accelerationX, dt);
-        verletIntegration(particle.positionY, particle.lastPositionY, particle.velocityY, accelerationY, dt);
+// The widest angle about the centre that two particles less than `reach`
+// apart can span when one is `radius` from it. Both are at least
+// radius - reach out, which bounds the chord's angle. Capped at PI, so of any
+// pair only the particle behind the other in the sweep finds it.
+float sweepWindow(float radius, float reach) {
+    float inner = radius - reach;
+    if (inner <= reach / 2) return PI;
+    return 2.0f * std::asin(reach / (2.0f * inner));
+}
 
-        float distanceFromOrigin = sqrt(particle.positionX * particle.positionX + particle.positionY * particle.positionY);
-        if (distanceFromOrigin + ballRadius > bowlRadius) {
-            float overlap = (distanceFromOrigin + ballRadius) - bowlRadius;
-            float normalizationFactor = distanceFromOrigin / (distanceFromOrigin + overlap);
-            particle.positionX *= normalizationFactor;
-            particle.positionY *= normalizationFactor;
+void prepareBroadphase(float height) {
+    if (broadphase == Broadphase::SweepAndPrune) sortAwakeByAngle();
+    else buildStripes(stripes, 0, awakeCount, height);
+}
 
-            float normalX = particle.positionX / distanceFromOrigin;
-            float normalY = particle.positionY / distanceFromOrigin;
-            float dotProduct = particle.velocityX * normalX + particle.velocityY * normalY;
-            particle.velocityX = particle.velocityX - 2 * dotProduct * normalX;
-            particle.velocityY = particle.velocityY - 2 * dotProduct * normalY;
-            particle.velocityX *= 0.8f;
-            particle.velocityY *= 0.8f;
+// Visits the pairs `stripe` owns: its own pairs, then each of its particles
+// with every particle in the stripe above.
+template <typename Visit>
+void forEachStripePair(int stripe, Visit&& visit) {
+    const int begin = stripes.start[stripe];
+    const int end = stripes.start[stripe + 1];
+    const int aboveEnd = stripe + 1 < stripes.count ? stripes.start[stripe + 2] : end;
+    for (int a = begin; a < end; ++a) {
+        for (int b = a + 1; b < aboveEnd; ++b) {
+            visit(static_cast<size_t>(stripes.entries[a]), static_cast<size_t>(stripes.entries[b]));
         }
     }
+}
 
-    for (size_t i = 0; i < particles.size(); ++i) {
-        for (size_t j = i + 1; j < particles.size(); ++j) {
-            float dx = particles[j].positionX - particles[i].positionX;
-            float dy = particles[j].positionY - particles[i].positionY;
-            float distance = sqrt(dx * dx + dy * dy);
-            if (distance < 2 * ballRadius) {
-                float overlap = 2 * ballRadius - distance;
-                float nx = dx / distance;
-                float ny = dy / distance;
-                particles[i].positionX -= nx * overlap / 2;
-                particles[i].positionY -= ny * overlap / 2;
-                particles[j].positionX += nx * overlap / 2;
-                particles[j].positionY += ny * overlap / 2;
-
-                float vi_dot_n = particles[i].velocityX * nx + particles[i].velocityY * ny;
-                float vj_dot_n = particles[j].velocityX * nx + particles[j].velocityY * ny;
-                float vi_nx = vi_dot_n * nx;
-                float vi_ny = vi_dot_n * ny;
-                float vj_nx = vj_dot_n * nx;
-                float vj_ny = vj_dot_n * ny;
-
-                particles[i].velocityX = particles[i].velocityX - vi_nx + vj_nx;
-                particles[i].velocityY = particles[i].velocityY - vi_ny + vj_ny;
-                particles[j].velocityX = particles[j].velocityX - vj_nx + vi_nx;
-                particles[j].velocityY = particles[j].velocityY - vj_ny + vi_ny;
+// Calls visit(j) once for every awake pair (i, j) that i owns and that is
+// within `reach` horizontally (with the stripes) or radially (with sweep and
+// prune). With the stripes `reach` must not exceed their height.
+template <typename Visit>
+void forEachOwnedNeighbor(int i, float reach, Visit&& visit) {
+    const float x = particles.posX[i];
+    const float y = particles.posY[i];
+    if (broadphase == Broadphase::SweepAndPrune) {
+        const float radius = std::sqrt(x * x + y * y);
+        const float window = sweepWindow(radius, reach);
+        for (int step = 1; step < awakeCount; ++step) {
+            int j = i + step;
+            float gap;
+            if (j < awakeCount) {
+                gap = sweepAngles[j] - sweepAngles[i];
+            } else {
+                j -= awakeCount;
+                gap = sweepAngles[j] - sweepAngles[i] + 2.0f * PI;
             }
+            if (!(gap < window)) break;
+            float other = std::sqrt(particles.posX[j] * particles.posX[j] + particles.posY[j] * particles.posY[j]);
+            if (std::fabs(other - radius) < reach) visit(j);
         }
+        return;
     }
-    // Add new particles if the spacebar is held down and enough time has passed
-    static float timeElapsed = 0.0f;
-    timeElapsed += dt;
-    if (isSpacePressed && timeElapsed - lastParticleCreationTime >= PARTICLE_CREATION_INTERVAL) {
-        Particle newParticle = { static_cast<float>(mouseX), static_cast<float>(mouseY), 0.0f, 0.0f, static_cast<float>(mouseX), static_cast<float>(mouseY) };
-        particles.push_back(newParticle);
-        lastParticleCreationTime = timeElapsed;
+    const int stripe = stripes.stripeOf[i];
+    const int end = stripe + 1 < stripes.count ? stripes.start[stripe + 2] : stripes.start[stripe + 1];
+    for (int e = stripes.start[stripe]; e < end; ++e) {
+        int j = stripes.entries[e];
+        if ((j > i || stripes.stripeOf[j] != stripe) && std::fabs(particles.posX[j] - x) < reach) visit(j);
     }
 }
 
-void render() {
-    glClear(GL_COLOR_BUFFER_BIT);
+// Visits every pair the broadphase finds within `reach` once, in a fixed order.
+template <typename Visit>
+void forEachPair(float reach, Visit&& visit) {
+    if (broadphase == Broadphase::SweepAndPrune) {
+        for (int i = 0; i < awakeCount; ++i) {
+            forEachOwnedNeighbor(i, reach, [&](int j) {
+                pairTests++;
+                visit(static_cast<size_t>(i), static_cast<size_t>(j));
+            });
+        }
+        return;
+    }
+    for (int stripe = 0; stripe < stripes.count; ++stripe) {
+        forEachStripePair(stripe, [&](size_t i, size_t j) {
+            pairTests++;
+            visit(i, j);
+        });
+    }
+}
+
+// Calls visit(j) for every sleeping particle j in the stripes around awake
+// particle i that is within a stripe height of it horizontally.
+template <typename Visit>
+void forEachSleepingNeighbor(int i, Visit&& visit) {
+    if (awakeCount == static_cast<int>(particles.size())) return;
+    const Stripes& index = sleepingStripes;
+    const int stripe = stripeAt(index, particles.posY[i]);
+    const int begin = index.start[std::max(0, stripe - 1)];
+    const int end = index.start[std::min(index.count, stripe + 2)];
+    for (int e = begin; e < end; ++e) {
+        int j = index.entries[e];
+        if (std::fabs(particles.posX[j] - particles.posX[i]) < index.height) visit(j);
+    }
+}
+
+void indexSleepers(float height) {
+    if (!sleeping.sleepersChanged) return;
+    buildStripes(sleepingStripes, awakeCount, static_cast<int>(particles.size()), height);
+    sleeping.sleepersChanged = false;
+}
+
+// Once per tick, after the substeps.
+void updateSleep(ParticleDriver<BowlScene>&, float substepDt) {
+    if (!sleeping.enabled || !updateRest(sleeping, particles, substepDt)) return;
+    // Contacts have moved particles since the substep's broadphase, and wakes
+    // and spawns have reordered them.
+    const float reach = 2 * scene.radius * CONTACT_MARGIN;
+    prepareBroadphase(reach);
+    indexSleepers(reach);
+    sleepIslands(sleeping, particles, &renderPositions, reach,
+                 [](int i, float reach, auto&& visit) { forEachOwnedNeighbor(i, reach, visit); },
+                 [](int i, auto&& visit) { forEachSleepingNeighbor(i, visit); });
+}
+
+void collideStripe(int stripe, float radiusSum) {
+    long long tests = 0, hits = 0;
+    forEachStripePair(stripe, [&](size_t i, size_t j) {
+        tests++;
+        if (collidePair(particles, i, j, radiusSum)) hits++;
+    });
+    stripes.pairTests[stripe] = tests;
+    stripes.contacts[stripe] = hits;
+}
+
+// Even stripes, then odd ones, each set in parallel on the pool.
+void collideStripes(float radiusSum) {
+    stripes.pairTests.assign(stripes.count, 0);
+    stripes.contacts.assign(stripes.count, 0);
+    for (int parity = 0; parity < 2; ++parity) {
+        runTasks(contactPool, (stripes.count - parity + 1) / 2, [&](int task, int) {
+            collideStripe(2 * task + parity, radiusSum);
+        });
+    }
+    for (int stripe = 0; stripe < stripes.count; ++stripe) {
+        pairTests += stripes.pairTests[stripe];
+        contacts += stripes.contacts[stripe];
+    }
+}
+
+// Resolves each awake particle's owned pairs outwards from the bottom of the
+// bowl, nearer side first, much as the stripes resolve upwards: a particle is
+// pushed off the ones below it after they have been resolved. Resolving in
+// sweep order instead carries every push along the pile within one pass, and
+// a dense pile never comes to rest.
+void collideSweep(float radiusSum) {
+    int right = static_cast<int>(std::lower_bound(sweepAngles.begin(), sweepAngles.end(), 0.0f) - sweepAngles.begin());
+    int left = right - 1;
+    while (left >= 0 || right < awakeCount) {
+        int i = right >= awakeCount || (left >= 0 && -sweepAngles[left] < sweepAngles[right]) ? left-- : right++;
+        forEachOwnedNeighbor(i, radiusSum, [&](int j) {
+            pairTests++;
+            if (collidePair(particles, i, j, radiusSum)) contacts++;
+        });
+    }
+}
+
+void updatePhysics(ParticleDriver<BowlScene>&, float dt) {
+    const size_t count = awakeCount;
+    const float radiusSum = 2 * scene.radius;
+    {
+        ProfileScope scope("integrate");
+        stepScene(scene, particles, dt, count);
+    }
+    {
+        ProfileScope scope("broadphase");
+        prepareBroadphase(radiusSum * CONTACT_MARGIN);
+        indexSleepers(radiusSum * CONTACT_MARGIN);
+    }
 
-    for (const auto& particle : particles) {
-        glBegin(GL_POLYGON);
-        for (int i = 0; i < 360; i++) {
-            float degInRad = i * PI / 180;
-            glVertex2f(cos(degInRad) * ballRadius + particle.positionX, sin(degInRad) * ballRadius + particle.positionY);
+    if (contactResponse == ContactResponse::Xpbd) {
+        const float reach = radiusSum * CONTACT_MARGIN;
+        clearContacts(contactSolver);
+        {
+            ProfileScope scope("pairs");
+            forEachPair(reach, [&](size_t i, size_t j) {
+                float dx = particles.posX[j] - particles.posX[i];
+                float dy = particles.posY[j] - particles.posY[i];
+                float distance = sqrt(dx * dx + dy * dy);
+                if (distance < radiusSum) contacts++;
+                if (distance < reach) addContact(contactSolver, static_cast<int>(i), static_cast<int>(j));
+            });
         }
-        glEnd();
+        ProfileScope scope("solve");
+        solveSceneContacts(scene, contactSolver, contactPool, particles, count, dt, contactSettings);
+        solverIterations += contactSolver.iterationsRun;
+        solverResidual += contactSolver.residual;
+    } else {
+        // Tests and responses are one pass here, so they are timed together.
+        ProfileScope scope("pairs");
+        if (broadphase == Broadphase::SweepAndPrune) collideSweep(radiusSum);
+        else collideStripes(radiusSum);
     }
+    {
+        ProfileScope scope("sleepers");
+        collideSleepers(sleeping, particles, &renderPositions, radiusSum, dt,
+                        [](int i, auto&& visit) { forEachSleepingNeighbor(i, visit); }, pairTests, contacts);
+    }
+    // Damping reads velocity, so it has to see the contacts. Without this the
+    // drag would act only on what the pair swaps and bowl bounces leave in it,
+    // and a pile would never come to rest.
+    deriveVelocity(particles.posX.data(), particles.lastPosX.data(), particles.velX.data(), dt, awakeCount);
+    deriveVelocity(particles.posY.data(), particles.lastPosY.data(), particles.velY.data(), dt, awakeCount);
+
+    updateSpawner(driver, dt);
+}
+
+void render(const RenderPositions& positions) {
+    ProfileScope scope("render");
+    glClear(GL_COLOR_BUFFER_BIT);
+
+    drawCircles(circles, positions.x.data(), positions.y.data(), positions.x.size(),
+                ballRadius, 1.0f, 1.0f, 1.0f);
 
     // render circular bowl
     glBegin(GL_LINE_LOOP);
@@ -141,9 +395,14 @@ void render() {
 
 void mouse_button_callback(GLFWwindow* window, int button, int action, int mods) {
     if (button == GLFW_MOUSE_BUTTON_LEFT) {
-        double xpos, ypos;
+        double xpos, ypos, worldX, worldY;
         glfwGetCursorPos(window, &xpos, &ypos);
-        screenToWorld(window, xpos, ypos, mouseX, mouseY);
+        screenToWorld(window, xpos, ypos, worldX, worldY);
+        InputMessage message;
+        message.moved = true;
+        message.x = static_cast<float>(worldX);
+        message.y = static_cast<float>(worldY);
+        sendInput(driver, message);
     }
 }
 
@@ -151,27 +410,134 @@ void cursor_position_callback(GLFWwindow* window, double xpos, double ypos) {
     int width, height;
     glfwGetFramebufferSize(window, &width, &height);
 
-    mouseX = (xpos / width) * 2.0f - 1.0f;
-    mouseY = (ypos / height) * 2.0f - 1.0f;
-    mouseY = -mouseY;
+    InputMessage message;
+    message.moved = true;
+    message.x = static_cast<float>((xpos / width) * 2.0f - 1.0f);
+    message.y = static_cast<float>(-((ypos / height) * 2.0f - 1.0f));
+    sendInput(driver, message);
 }
 
 void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods) {
     if (key == GLFW_KEY_SPACE) {
+        InputMessage message;
         if (action == GLFW_PRESS) {
-            isSpacePressed = true;
+            message.action = 1;
         } else if (action == GLFW_RELEASE) {
-            isSpacePressed = false;
+            message.action = 0;
+        }
+        if (message.action >= 0) sendInput(driver, message);
+    }
+}
+
+// Seeded particles inside the bowl plus space held with the cursor at random
+// points, stepped at a fixed dt without a window. A loaded snapshot replaces the
+// seeded particles, and its recorded input, if any, replaces the random cursor.
+// With --settle nothing spawns: the particles fall into a pile in the bottom of
+// the bowl and its islands sleep.
+int runBenchmark(const BenchOptions& options) {
+    std::mt19937 rng(options.seed);
+    std::uniform_real_distribution<float> angle(0.0f, 2.0f * PI);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    auto randomPoint = [&](float& x, float& y) {
+        float r = (bowlRadius - ballRadius) * std::sqrt(unit(rng));
+        float a = angle(rng);
+        x = r * std::cos(a);
+        y = r * std::sin(a);
+    };
+    if (!driver.loadedSnapshot.base) {
+        for (int i = 0; i < options.count; ++i) {
+            float x, y;
+            randomPoint(x, y);
+            addParticle(particles, x, y);
         }
+        wakeAll(sleeping, particles);
     }
+    startRecording(driver, options.dt);
+
+    bool randomInput = driver.replay.count == 0 && !settleBench;
+    if (randomInput) driver.spawnHeld = true;
+    auto start = BenchClock::now();
+    for (int step = 0; step < options.steps; ++step) {
+        if (randomInput) {
+            float x, y;
+            randomPoint(x, y);
+            driver.spawnX = x;
+            driver.spawnY = y;
+        }
+        runTick(driver, options.dt);
+    }
+    auto elapsed = BenchClock::now() - start;
+
+    printBenchReport("particles", options, elapsed, {
+        { "pair_tests", static_cast<double>(pairTests) },
+        { "collisions", static_cast<double>(contacts) },
+        { "awake", static_cast<double>(driver.awakeTicks) },
+        { "solver_iterations", static_cast<double>(solverIterations) / fixedStep.substeps },
+        { "solver_residual", solverResidual / fixedStep.substeps },
+    });
+    return 0;
 }
 
-int main() {
+int main(int argc, char** argv) {
+    BenchOptions bench;
+    int threadCount = std::max(1u, std::thread::hardware_concurrency());
+    driver.spawnInterval = PARTICLE_CREATION_INTERVAL;
+    driver.reach = PARTICLE_REACH;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threadCount = std::max(1, std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--broadphase") == 0 && i + 1 < argc) {
+            const char* name = argv[++i];
+            if (std::strcmp(name, "stripes") == 0) {
+                broadphase = Broadphase::Stripes;
+            } else if (std::strcmp(name, "sap") == 0) {
+                broadphase = Broadphase::SweepAndPrune;
+            } else {
+                std::cerr << "Unknown broadphase: " << name << " (expected stripes or sap)\n";
+                return -1;
+            }
+        } else if (std::strcmp(argv[i], "--solver") == 0 && i + 1 < argc) {
+            const char* name = argv[++i];
+            if (std::strcmp(name, "pairwise") == 0) {
+                contactResponse = ContactResponse::Pairwise;
+            } else if (std::strcmp(name, "xpbd") == 0) {
+                contactResponse = ContactResponse::Xpbd;
+            } else {
+                std::cerr << "Unknown solver: " << name << " (expected pairwise or xpbd)\n";
+                return -1;
+            }
+        } else if (std::strcmp(argv[i], "--settle") == 0) {
+            settleBench = true;
+        } else if (!parseBenchOption(i, argc, argv, bench) && !parseDriverOption(i, argc, argv, driver) &&
+                   !parseContactOption(i, argc, argv, contactSettings)) {
+            std::cerr << "Unknown option: " << argv[i] << "\n";
+            return -1;
+        }
+    }
+    if (!startDriver(driver, bench)) return -1;
+    reserveContacts(contactSolver, 8 * particles.capacity, particles.capacity);
+    for (Stripes* index : { &stripes, &sleepingStripes }) {
+        index->stripeOf.reserve(particles.capacity);
+        index->entries.reserve(particles.capacity);
+    }
+    sweepAngles.reserve(particles.capacity);
+    sweepOrder.reserve(particles.capacity);
+    sweepScratch.values.reserve(particles.capacity);
+    sweepScratch.words.reserve(particles.capacity);
+    if (bench.enabled) {
+        startStealingPool(contactPool, threadCount);
+        int result = runBenchmark(bench);
+        stopStealingPool(contactPool);
+        if (!finishDriver(driver)) result = -1;
+        return result;
+    }
+
     GLFWwindow* window;
     if (!glfwInit()) {
         std::cerr << "Failed to initialize GLFW\n";
         return -1;
     }
+    hideOutputWindow(driver.outputOptions);
     window = glfwCreateWindow(640, 640, "Particle Simulation", NULL, NULL);
     if (!window) {
         glfwTerminate();
@@ -181,25 +547,17 @@ int main() {
 
     glfwMakeContextCurrent(window);
     glewInit();
+    initCircleRenderer(circles);
+    startStealingPool(contactPool, threadCount);
 
     glfwSetMouseButtonCallback(window, mouse_button_callback);
     glfwSetCursorPosCallback(window, cursor_position_callback);
     glfwSetKeyCallback(window, key_callback);
+    bool written = runWindow(driver, window, [](float, const RenderPositions& positions) { render(positions); });
 
-    float lastTime = glfwGetTime();
-
-    while (!glfwWindowShouldClose(window)) {
-        float currentTime = glfwGetTime();
-        float dt = currentTime - lastTime;
-        lastTime = currentTime;
-
-        updatePhysics(dt);
-        render();
-        glfwSwapBuffers(window);
-        glfwPollEvents();
-    }
-
+    stopStealingPool(contactPool);
     glfwDestroyWindow(window);
     glfwTerminate();
-    return 0;
+    bool saved = finishDriver(driver) && written;
+    return saved ? 0 : -1;
 }
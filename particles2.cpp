@@ -2,29 +2,85 @@
 #include <GLFW/glfw3.h>
 #include <iostream>
 #include <cmath>
+#include <algorithm>
 #include <vector>
+#include <random>
+#include <thread>
+#include <cstdlib>
+#include <cstring>
+#include "bench.h"
+#include "circle_renderer.h"
+#include "contact_solver.h"
+#include "particle_driver.h"
+#include "physics_core.h"
+#include "work_pool.h"
 
 const float PI = 3.14159f;
 const float g = 9.81f;
-const float mass = 1.0f;
 const float partRadius = 0.04f;
 const float partCreationInterval = 0.0f;
-const float damping = 0.0f;  // Adjusted damping factor
-
-float lastPartCreationTime = 0.0f;
-bool isMousePressed = false;
-double mouseX = 0.0f, mouseY = 0.0f;
-
-struct Particle {
-    float posX;
-    float posY;
-    float velX;
-    float velY;
-    float lastPosX;
-    float lastPosY;
+
+// Undamped discs in the window's square
+using BoxScene = ParticleScene<BoxBoundary, UniformGravity>;
+const BoxScene scene = { { -1.0f, 1.0f }, { g }, partRadius };
+
+// Spawning, input, ticks, snapshots and the window loop (particle_driver.h).
+// Holding the mouse spawns a particle at it every substep.
+ParticleDriver<BoxScene> driver;
+ParticleStore& particles = driver.particles;
+RenderPositions& renderPositions = driver.renderPositions;
+FixedStep& fixedStep = driver.fixedStep;
+CircleRenderer circles;
+
+// Broadphase: particles are bucketed into a hashed uniform grid whose cells are
+// one particle diameter wide, so only particles in neighbouring cells can touch.
+const float cellSize = 2.0f * partRadius;
+
+struct SpatialHash {
+    int tableSize = 0;
+    std::vector<int> cellStart;    // tableSize + 1 offsets into cellEntries
+    std::vector<int> cellEntries;  // particle indices, grouped by bucket
+    std::vector<int> particleCell; // bucket of each particle
+    std::vector<int> cellX, cellY; // grid cell of each particle when binned
+    int firstRow = 0;
+    int rowCount = 0;
+    std::vector<int> rowStart;     // rowCount + 1 offsets into rowEntries
+    std::vector<int> rowEntries;   // particle indices, grouped by grid row
+};
+
+// Contact response (--solver xpbd): by default each touching pair is pushed
+// apart once as the broadphase finds it. XPBD instead gathers the substep's
+// contacts and solves them together over --iterations projections.
+enum class ContactResponse {
+    Pairwise,
+    Xpbd
 };
+ContactResponse contactResponse = ContactResponse::Pairwise;
+ContactSolver contactSolver;
+ContactSettings contactSettings;
+long long solverIterations = 0;
+double solverResidual = 0.0;
+
+SpatialHash spatialHash;  // awake particles, rebuilt every substep
+SpatialHash sleepingHash; // sleeping particles, rebuilt when they change
+
+// Sleeping (particle_sleep.h), which --no-sleep turns off.
+const float CONTACT_MARGIN = 1.1f; // slack on touching for islands and XPBD contacts
+ParticleSleep& sleeping = driver.sleeping;
+int& awakeCount = sleeping.awakeCount;
+bool settleBench = false;           // --settle: benchmark without the mouse, so the cloud comes to rest
 
-std::vector<Particle> particles;
+// Contacts are resolved one grid row at a time. A pair belongs to the row of its
+// lower particle, so resolving row r writes only to rows r and r + 1; all even
+// rows can then run in parallel, followed by all odd rows, with no locks. The
+// result depends only on the particles, not on the thread count or schedule.
+StealingPool collisionPool;
+std::vector<long long> rowPairTests;
+std::vector<long long> rowContacts;
+
+// Broadphase statistics, accumulated for the benchmark report
+long long& pairTests = driver.pairTests;
+long long& contacts = driver.contacts;
 
 void screenToWorld(
     GLFWwindow* window,
@@ -40,141 +96,341 @@ void screenToWorld(
     wy = 1.0 - (sy / height) * 2.0;
 }
 
-void verlet(
-    float& position,
-    float& lastPosition,
-    float acceleration,
-    float dt
-) {
-    float nextPosition = 2.0f * position - lastPosition + acceleration * dt * dt;
-    lastPosition = position;
-    position = nextPosition;
+int cellCoord(float position) {
+    return static_cast<int>(std::floor(position / cellSize));
 }
 
-void updateVelocity(Particle& particle, float dt) {
-    particle.velX = (particle.posX - particle.lastPosX) / dt;
-    particle.velY = (particle.posY - particle.lastPosY) / dt;
+int hashCell(const SpatialHash& hash, int cellX, int cellY) {
+    unsigned int h = static_cast<unsigned int>(cellX) * 92837111u ^ static_cast<unsigned int>(cellY) * 689287499u;
+    return static_cast<int>(h % static_cast<unsigned int>(hash.tableSize));
 }
 
-void resolveCollision(Particle& p1, Particle& p2, float nx, float ny, float overlap) {
-    p1.posX -= nx * overlap / 2;
-    p1.posY -= ny * overlap / 2;
-    p2.posX += nx * overlap / 2;
-    p2.posY += ny * overlap / 2;
-
-    float vi_dot_n = p1.velX * nx + p1.velY * ny;
-    float vj_dot_n = p2.velX * nx + p2.velY * ny;
+// Counting sort of particles [begin, end) into hash buckets and into grid rows.
+// Per-particle arrays are indexed by particle index. The buffers only ever
+// grow, so once the particle count settles a rebuild performs no allocations.
+void buildSpatialHash(SpatialHash& hash, int begin, int end) {
+    const int count = end - begin;
+    if (hash.tableSize == 0 || hash.tableSize < 2 * count) {
+        hash.tableSize = std::max(1024, 4 * count);
+        hash.cellStart.resize(hash.tableSize + 1);
+    }
+    if (static_cast<int>(hash.cellEntries.size()) < end) {
+        const size_t entries = std::max(2 * static_cast<size_t>(end), particles.capacity);
+        hash.cellEntries.resize(entries);
+        hash.particleCell.resize(entries);
+        hash.cellX.resize(entries);
+        hash.cellY.resize(entries);
+        hash.rowEntries.resize(entries);
+    }
 
-    float vi_nx = vi_dot_n * nx;
-    float vi_ny = vi_dot_n * ny;
-    float vj_nx = vj_dot_n * nx;
-    float vj_ny = vj_dot_n * ny;
+    std::fill(hash.cellStart.begin(), hash.cellStart.end(), 0);
+    int firstRow = 0, lastRow = -1;
+    for (int i = begin; i < end; ++i) {
+        int cellX = cellCoord(particles.posX[i]);
+        int cellY = cellCoord(particles.posY[i]);
+        int cell = hashCell(hash, cellX, cellY);
+        hash.cellX[i] = cellX;
+        hash.cellY[i] = cellY;
+        hash.particleCell[i] = cell;
+        hash.cellStart[cell + 1]++;
+        if (i == begin || cellY < firstRow) firstRow = cellY;
+        if (i == begin || cellY > lastRow) lastRow = cellY;
+    }
+    for (int cell = 0; cell < hash.tableSize; ++cell) {
+        hash.cellStart[cell + 1] += hash.cellStart[cell];
+    }
+    // Scatter back to front so every bucket ends up sorted by particle index and
+    // cellStart[cell + 1] is walked down to the start of bucket `cell`.
+    for (int i = end - 1; i >= begin; --i) {
+        int cell = hash.particleCell[i];
+        hash.cellEntries[--hash.cellStart[cell + 1]] = i;
+    }
+    for (int cell = 0; cell < hash.tableSize; ++cell) {
+        hash.cellStart[cell] = hash.cellStart[cell + 1];
+    }
+    hash.cellStart[hash.tableSize] = count;
 
-    p1.velX = p1.velX - vi_nx + vj_nx;
-    p1.velY = p1.velY - vi_ny + vj_ny;
-    p2.velX = p2.velX - vj_nx + vi_nx;
-    p2.velY = p2.velY - vj_ny + vi_ny;
+    // Rows keep ascending particle order, which fixes the order contacts resolve in.
+    hash.firstRow = firstRow;
+    hash.rowCount = lastRow - firstRow + 1;
+    hash.rowStart.assign(hash.rowCount + 1, 0);
+    for (int i = begin; i < end; ++i) {
+        hash.rowStart[hash.cellY[i] - firstRow + 1]++;
+    }
+    for (int row = 0; row < hash.rowCount; ++row) {
+        hash.rowStart[row + 1] += hash.rowStart[row];
+    }
+    for (int i = begin; i < end; ++i) {
+        hash.rowEntries[hash.rowStart[hash.cellY[i] - firstRow]++] = i;
+    }
+    for (int row = hash.rowCount; row > 0; --row) {
+        hash.rowStart[row] = hash.rowStart[row - 1];
+    }
+    hash.rowStart[0] = 0;
 }
 
-void updatePhysics(GLFWwindow* window, float dt) {
-    int width, height;
-    glfwGetWindowSize(window, &width, &height);
+// Calls visit(j) for every awake particle j whose pair with awake particle i
+// is owned by i: neighbours in i's own row with a higher index and all
+// neighbours in the row above.
+template <typename Visit>
+void forEachOwnedNeighbor(int i, Visit&& visit) {
+    const int cellX = spatialHash.cellX[i];
+    const int cellY = spatialHash.cellY[i];
 
-    const float forceX = 0.0f;
-    const float forceY = -g * mass;
-    const float accelX = forceX / mass;
-    const float accelY = forceY / mass;
-    const float radiusSum = 2.0f * partRadius;
+    // Distinct neighbour cells can hash to the same bucket; visit each bucket once
+    // so a pair is never resolved twice.
+    int visited[6];
+    int visitedCount = 0;
+    for (int oy = 0; oy <= 1; ++oy) {
+        for (int ox = -1; ox <= 1; ++ox) {
+            int cell = hashCell(spatialHash, cellX + ox, cellY + oy);
+            if (std::find(visited, visited + visitedCount, cell) != visited + visitedCount) continue;
+            visited[visitedCount++] = cell;
 
-    for (auto& particle : particles) {
-        verlet(particle.posX, particle.lastPosX, accelX, dt);
-        verlet(particle.posY, particle.lastPosY, accelY, dt);
+            for (int e = spatialHash.cellStart[cell]; e < spatialHash.cellStart[cell + 1]; ++e) {
+                int j = spatialHash.cellEntries[e];
+                int rowOffset = spatialHash.cellY[j] - cellY;
+                int columnOffset = spatialHash.cellX[j] - cellX;
+                // Skip cells that merely share the bucket, and pairs owned by j
+                if (rowOffset < 0 || rowOffset > 1 || columnOffset < -1 || columnOffset > 1) continue;
+                if (rowOffset == 0 && j <= i) continue;
+                visit(j);
+            }
+        }
+    }
+}
 
-        updateVelocity(particle, dt);
+// Calls visit(j) for every sleeping particle j in the 3x3 cells around
+// particle i's position.
+template <typename Visit>
+void forEachSleepingNeighbor(int i, Visit&& visit) {
+    if (sleepingHash.tableSize == 0 || awakeCount == static_cast<int>(particles.size())) return;
+    const int cellX = cellCoord(particles.posX[i]);
+    const int cellY = cellCoord(particles.posY[i]);
+    int visited[9];
+    int visitedCount = 0;
+    for (int oy = -1; oy <= 1; ++oy) {
+        for (int ox = -1; ox <= 1; ++ox) {
+            int cell = hashCell(sleepingHash, cellX + ox, cellY + oy);
+            if (std::find(visited, visited + visitedCount, cell) != visited + visitedCount) continue;
+            visited[visitedCount++] = cell;
 
-        // Check for border collisions and respond accordingly
-        if (particle.posX - partRadius < -1.0f) {
-            particle.posX = -1.0f + partRadius;
-            particle.velX *= -1.0f;
-        }
-        if (particle.posX + partRadius > 1.0f) {
-            particle.posX = 1.0f - partRadius;
-            particle.velX *= -1.0f;
-        }
-        if (particle.posY - partRadius < -1.0f) {
-            particle.posY = -1.0f + partRadius;
-            particle.velY *= -1.0f;
-        }
-        if (particle.posY + partRadius > 1.0f) {
-            particle.posY = 1.0f - partRadius;
-            particle.velY *= -1.0f;
+            for (int e = sleepingHash.cellStart[cell]; e < sleepingHash.cellStart[cell + 1]; ++e) {
+                int j = sleepingHash.cellEntries[e];
+                int rowOffset = sleepingHash.cellY[j] - cellY;
+                int columnOffset = sleepingHash.cellX[j] - cellX;
+                if (rowOffset < -1 || rowOffset > 1 || columnOffset < -1 || columnOffset > 1) continue;
+                visit(j);
+            }
         }
     }
+}
 
-    for (size_t i = 0; i < particles.size(); ++i) {
-        for (size_t j = i + 1; j < particles.size(); ++j) {
-            float dx = particles[j].posX - particles[i].posX;
-            float dy = particles[j].posY - particles[i].posY;
-            float distanceSquared = dx * dx + dy * dy;
+void collideNeighbors(int i, float radiusSum, long long& tests, long long& hits) {
+    forEachOwnedNeighbor(i, [&](int j) {
+        tests++;
+        if (collidePair(particles, i, j, radiusSum)) hits++;
+    });
+}
 
-            if (distanceSquared < radiusSum * radiusSum) {
-                float distance = std::sqrt(distanceSquared);
-                float overlap = radiusSum - distance;
-                float nx = dx / distance;
-                float ny = dy / distance;
+void collideRow(int row, float radiusSum) {
+    long long tests = 0, hits = 0;
+    for (int e = spatialHash.rowStart[row]; e < spatialHash.rowStart[row + 1]; ++e) {
+        collideNeighbors(spatialHash.rowEntries[e], radiusSum, tests, hits);
+    }
+    rowPairTests[row] = tests;
+    rowContacts[row] = hits;
+}
 
-                resolveCollision(particles[i], particles[j], nx, ny, overlap);
-            }
-        }
+// Gathers candidate pairs a little beyond touching, so contacts that close
+// during the iterations are solved too; the solver ignores separated ones.
+void solveGatheredContacts(float radiusSum, float dt) {
+    const float reach = radiusSum * CONTACT_MARGIN;
+    clearContacts(contactSolver);
+    for (int i = 0; i < awakeCount; ++i) {
+        forEachOwnedNeighbor(i, [&](int j) {
+            pairTests++;
+            float dx = particles.posX[j] - particles.posX[i];
+            float dy = particles.posY[j] - particles.posY[i];
+            float distanceSquared = dx * dx + dy * dy;
+            if (distanceSquared >= reach * reach) return;
+            if (distanceSquared < radiusSum * radiusSum) contacts++;
+            addContact(contactSolver, i, j);
+        });
     }
+    solveSceneContacts(scene, contactSolver, collisionPool, particles, awakeCount, dt, contactSettings);
+    solverIterations += contactSolver.iterationsRun;
+    solverResidual += contactSolver.residual;
+}
 
-    static float timeElapsed = 0.0f;
-    timeElapsed += dt;
-    if (isMousePressed && timeElapsed - lastPartCreationTime >= partCreationInterval) {
-        Particle newParticle = { static_cast<float>(mouseX), static_cast<float>(mouseY), 0.0f, 0.0f, static_cast<float>(mouseX), static_cast<float>(mouseY) };
-        particles.push_back(newParticle);
-        lastPartCreationTime = timeElapsed;
+void resolveContacts(float radiusSum, float dt) {
+    if (contactResponse == ContactResponse::Xpbd) {
+        solveGatheredContacts(radiusSum, dt);
+        return;
+    }
+    const int rows = spatialHash.rowCount;
+    if (rows <= 0) return;
+    rowPairTests.assign(rows, 0);
+    rowContacts.assign(rows, 0);
+    for (int parity = 0; parity < 2; ++parity) {
+        runTasks(collisionPool, (rows - parity + 1) / 2, [&](int task, int) {
+            collideRow(2 * task + parity, radiusSum);
+        });
+    }
+    for (int row = 0; row < rows; ++row) {
+        pairTests += rowPairTests[row];
+        contacts += rowContacts[row];
     }
 }
 
-void render(float time) {
-    glClear(GL_COLOR_BUFFER_BIT);
-    for (const auto& particle : particles) {
-        float r = 0.5f + 0.5f * sin(time);
-        float g = 0.5f + 0.5f * sin(time + 2.0f * PI / 3.0f); // Phase shift for green
-        float b = 0.5f + 0.5f * sin(time + 4.0f * PI / 3.0f); // Phase shift for blue
-        glColor3f(r, g, b);
-        glBegin(GL_POLYGON);
-        for (int i = 0; i < 360; i++) {
-            float degInRad = i * PI / 180;
-            glVertex2f(
-                cos(degInRad) * partRadius + particle.posX,
-                sin(degInRad) * partRadius + particle.posY
-            );
-        }
-        glEnd();
+void indexSleepers() {
+    if (!sleeping.sleepersChanged) return;
+    buildSpatialHash(sleepingHash, awakeCount, static_cast<int>(particles.size()));
+    sleeping.sleepersChanged = false;
+}
+
+// Once per tick, after the substeps.
+void updateSleep(ParticleDriver<BoxScene>&, float substepDt) {
+    if (!sleeping.enabled || !updateRest(sleeping, particles, substepDt)) return;
+    // Contacts have moved particles since the substep's broadphase, and wakes
+    // and spawns have reordered them.
+    buildSpatialHash(spatialHash, 0, awakeCount);
+    indexSleepers();
+    sleepIslands(sleeping, particles, &renderPositions, 2.0f * partRadius * CONTACT_MARGIN,
+                 [](int i, float, auto&& visit) { forEachOwnedNeighbor(i, visit); },
+                 [](int i, auto&& visit) { forEachSleepingNeighbor(i, visit); });
+}
+
+void updatePhysics(ParticleDriver<BoxScene>&, float dt) {
+    const float radiusSum = 2.0f * scene.radius;
+    {
+        ProfileScope scope("integrate");
+        stepScene(scene, particles, dt, awakeCount);
+    }
+    {
+        ProfileScope scope("broadphase");
+        buildSpatialHash(spatialHash, 0, awakeCount);
+        indexSleepers();
+    }
+    {
+        ProfileScope scope("resolve");
+        resolveContacts(radiusSum, dt);
     }
+    {
+        ProfileScope scope("sleepers");
+        collideSleepers(sleeping, particles, &renderPositions, radiusSum, dt,
+                        [](int i, auto&& visit) { forEachSleepingNeighbor(i, visit); }, pairTests, contacts);
+    }
+
+    updateSpawner(driver, dt);
+}
+
+void render(float time, const RenderPositions& positions) {
+    ProfileScope scope("render");
+    glClear(GL_COLOR_BUFFER_BIT);
+    float r = 0.5f + 0.5f * sin(time);
+    float g = 0.5f + 0.5f * sin(time + 2.0f * PI / 3.0f); // Phase shift for green
+    float b = 0.5f + 0.5f * sin(time + 4.0f * PI / 3.0f); // Phase shift for blue
+    drawCircles(circles, positions.x.data(), positions.y.data(), positions.x.size(), partRadius, r, g, b);
 }
 
 void mouse_button_callback(GLFWwindow* window, int button, int action, int mods) {
     if (button == GLFW_MOUSE_BUTTON_LEFT) {
-        double xpos, ypos;
+        double xpos, ypos, worldX, worldY;
         glfwGetCursorPos(window, &xpos, &ypos);
-        screenToWorld(window, xpos, ypos, mouseX, mouseY);
+        screenToWorld(window, xpos, ypos, worldX, worldY);
+        InputMessage message;
+        message.moved = true;
+        message.x = static_cast<float>(worldX);
+        message.y = static_cast<float>(worldY);
         if (action == GLFW_PRESS) {
-            isMousePressed = true;
+            message.action = 1;
         } else if (action == GLFW_RELEASE) {
-            isMousePressed = false;
+            message.action = 0;
         }
+        sendInput(driver, message);
     }
 }
 
-int main() {
+// Seeded particle cloud plus a mouse held down at random points, stepped at a
+// fixed dt without a window. A loaded snapshot replaces the cloud, and its
+// recorded input, if any, replaces the random mouse. With --settle there is no
+// mouse: nothing spawns, the cloud falls into a pile and its islands sleep.
+int runBenchmark(const BenchOptions& options) {
+    std::mt19937 rng(options.seed);
+    std::uniform_real_distribution<float> coord(-1.0f + partRadius, 1.0f - partRadius);
+    if (!driver.loadedSnapshot.base) {
+        for (int i = 0; i < options.count; ++i) {
+            addParticle(particles, coord(rng), coord(rng));
+        }
+        wakeAll(sleeping, particles);
+    }
+    startRecording(driver, options.dt);
+
+    bool randomInput = driver.replay.count == 0 && !settleBench;
+    if (randomInput) driver.spawnHeld = true;
+    auto start = BenchClock::now();
+    for (int step = 0; step < options.steps; ++step) {
+        if (randomInput) {
+            driver.spawnX = coord(rng);
+            driver.spawnY = coord(rng);
+        }
+        runTick(driver, options.dt);
+    }
+    auto elapsed = BenchClock::now() - start;
+
+    printBenchReport("particles2", options, elapsed, {
+        { "pair_tests", static_cast<double>(pairTests) },
+        { "collisions", static_cast<double>(contacts) },
+        { "awake", static_cast<double>(driver.awakeTicks) },
+        { "solver_iterations", static_cast<double>(solverIterations) / fixedStep.substeps },
+        { "solver_residual", solverResidual / fixedStep.substeps },
+    });
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    BenchOptions bench;
+    int threadCount = std::max(1u, std::thread::hardware_concurrency());
+    driver.spawnInterval = partCreationInterval;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threadCount = std::max(1, std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--solver") == 0 && i + 1 < argc) {
+            const char* name = argv[++i];
+            if (std::strcmp(name, "pairwise") == 0) {
+                contactResponse = ContactResponse::Pairwise;
+            } else if (std::strcmp(name, "xpbd") == 0) {
+                contactResponse = ContactResponse::Xpbd;
+            } else {
+                std::cerr << "Unknown solver: " << name << " (expected pairwise or xpbd)\n";
+                return -1;
+            }
+        } else if (std::strcmp(argv[i], "--settle") == 0) {
+            settleBench = true;
+        } else if (!parseBenchOption(i, argc, argv, bench) && !parseDriverOption(i, argc, argv, driver) &&
+                   !parseContactOption(i, argc, argv, contactSettings)) {
+            std::cerr << "Unknown option: " << argv[i] << "\n";
+            return -1;
+        }
+    }
+    if (!startDriver(driver, bench)) return -1;
+    // Equal discs touch at most six others; the margin admits a few more.
+    reserveContacts(contactSolver, 8 * particles.capacity, particles.capacity);
+    if (bench.enabled) {
+        startStealingPool(collisionPool, threadCount);
+        int result = runBenchmark(bench);
+        stopStealingPool(collisionPool);
+        if (!finishDriver(driver)) result = -1;
+        return result;
+    }
+
     GLFWwindow* window;
     if (!glfwInit()) {
         std::cerr << "Failed to initialize GLFW\n";
         return -1;
     }
+    hideOutputWindow(driver.outputOptions);
     window = glfwCreateWindow(640, 640, "Particle Simulation", NULL, NULL);
     if (!window) {
         glfwTerminate();
@@ -184,23 +440,15 @@ int main() {
 
     glfwMakeContextCurrent(window);
     glewInit();
+    initCircleRenderer(circles);
+    startStealingPool(collisionPool, threadCount);
 
     glfwSetMouseButtonCallback(window, mouse_button_callback);
+    bool written = runWindow(driver, window, render);
 
-    float lastTime = glfwGetTime();
-
-    while (!glfwWindowShouldClose(window)) {
-        float currentTime = glfwGetTime();
-        float dt = currentTime - lastTime;
-        lastTime = currentTime;
-
-        updatePhysics(window, dt);
-        render(currentTime);
-        glfwSwapBuffers(window);
-        glfwPollEvents();
-    }
-
+    stopStealingPool(collisionPool);
     glfwDestroyWindow(window);
     glfwTerminate();
-    return 0;
+    bool saved = finishDriver(driver) && written;
+    return saved ? 0 : -1;
 }
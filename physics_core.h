@@ -0,0 +1,129 @@
+#pragma once
+
+// The physics the particle programs share: a Verlet step under a force model,
+// a boundary that keeps the discs in, and the response of a touching pair. A
+// scene names its boundary and force model as template arguments, and each
+// policy is a plain struct with its own overloads of integrateForces() and
+// projectBoundary(), so the choice is made by overload resolution and the
+// SIMD kernels inline straight into the step, with no virtual calls and no
+// branches on configuration. A new scene is a new policy struct and a pair of
+// overloads. Sleeping is in particle_sleep.h and the tick, spawning and
+// window loop in particle_driver.h; broadphase stays with the programs.
+//
+// The store is two-dimensional, so scenes are too.
+
+#include <cmath>
+#include <cstddef>
+#include "contact_solver.h"
+#include "particle_store.h"
+#include "work_pool.h"
+
+// Boundaries. Each keeps disc centres at least one radius inside.
+
+// The square [low, high] on both axes; clamped discs bounce back at full speed.
+struct BoxBoundary {
+    float low = -1.0f;
+    float high = 1.0f;
+};
+
+// A circle about the origin; discs poking out are pulled back and bounce off
+// its normal, losing speed.
+struct BowlBoundary {
+    float radius = 1.0f;
+    float restitution = 0.8f;
+};
+
+inline void projectBoundary(const BoxBoundary& box, ParticleStore& store, float radius, std::size_t count) {
+    clampToWalls(store.posX.data(), store.velX.data(), box.low + radius, box.high - radius, count);
+    clampToWalls(store.posY.data(), store.velY.data(), box.low + radius, box.high - radius, count);
+}
+
+inline void projectBoundary(const BowlBoundary& bowl, ParticleStore& store, float radius, std::size_t count) {
+    clampToBowl(store.posX.data(), store.posY.data(), store.velX.data(), store.velY.data(),
+                bowl.radius, radius, bowl.restitution, count);
+}
+
+// Force models, as accelerations on unit masses.
+
+// Constant downward gravity. Velocity plays no part in the step, so it is
+// derived from it afterwards for anything that reports it.
+struct UniformGravity {
+    float gravity = 9.8f;
+};
+
+// Gravity plus drag proportional to velocity. The velocity the drag reads is
+// the one contacts and the boundary leave behind.
+struct DampedGravity {
+    float gravity = 9.8f;
+    float damping = 0.2f; // per second
+};
+
+inline void integrateForces(const UniformGravity& force, ParticleStore& store, float dt, std::size_t count) {
+    integrateVerlet(store.posX.data(), store.lastPosX.data(), store.velX.data(), 0.0f, 0.0f, dt, count);
+    integrateVerlet(store.posY.data(), store.lastPosY.data(), store.velY.data(), -force.gravity, 0.0f, dt, count);
+    deriveVelocity(store.posX.data(), store.lastPosX.data(), store.velX.data(), dt, count);
+    deriveVelocity(store.posY.data(), store.lastPosY.data(), store.velY.data(), dt, count);
+}
+
+inline void integrateForces(const DampedGravity& force, ParticleStore& store, float dt, std::size_t count) {
+    integrateVerlet(store.posX.data(), store.lastPosX.data(), store.velX.data(), 0.0f, -force.damping, dt, count);
+    integrateVerlet(store.posY.data(), store.lastPosY.data(), store.velY.data(),
+                    -force.gravity, -force.damping, dt, count);
+}
+
+template <typename Boundary, typename Force>
+struct ParticleScene {
+    Boundary boundary;
+    Force force;
+    float radius = 0.05f; // of every disc
+};
+
+// Moves the first `count` particles through one substep and back inside the
+// boundary.
+template <typename Boundary, typename Force>
+void stepScene(const ParticleScene<Boundary, Force>& scene, ParticleStore& store, float dt, std::size_t count) {
+    integrateForces(scene.force, store, dt, count);
+    projectBoundary(scene.boundary, store, scene.radius, count);
+}
+
+// If discs i and j overlap, pushes them apart along the line between their
+// centres and swaps the normal components of their velocities, as an elastic
+// collision of equal masses would. Coincident discs have no normal and are
+// left alone. Returns whether they touched.
+inline bool collidePair(ParticleStore& store, std::size_t i, std::size_t j, float radiusSum) {
+    float dx = store.posX[j] - store.posX[i];
+    float dy = store.posY[j] - store.posY[i];
+    // One combined test keeps the common case, a miss, to a single branch.
+    float distance = std::sqrt(dx * dx + dy * dy);
+    if (!(distance < radiusSum && distance > 0.0f)) return false;
+
+    float overlap = radiusSum - distance;
+    float nx = dx / distance;
+    float ny = dy / distance;
+    store.posX[i] -= nx * overlap / 2;
+    store.posY[i] -= ny * overlap / 2;
+    store.posX[j] += nx * overlap / 2;
+    store.posY[j] += ny * overlap / 2;
+
+    float vi_dot_n = store.velX[i] * nx + store.velY[i] * ny;
+    float vj_dot_n = store.velX[j] * nx + store.velY[j] * ny;
+    float vi_nx = vi_dot_n * nx;
+    float vi_ny = vi_dot_n * ny;
+    float vj_nx = vj_dot_n * nx;
+    float vj_ny = vj_dot_n * ny;
+
+    store.velX[i] = store.velX[i] - vi_nx + vj_nx;
+    store.velY[i] = store.velY[i] - vi_ny + vj_ny;
+    store.velX[j] = store.velX[j] - vj_nx + vi_nx;
+    store.velY[j] = store.velY[j] - vj_ny + vi_ny;
+    return true;
+}
+
+// Solves the contacts gathered in `solver` among the first `count` particles
+// with XPBD, projecting the scene's boundary in every iteration.
+template <typename Boundary, typename Force>
+void solveSceneContacts(const ParticleScene<Boundary, Force>& scene, ContactSolver& solver, StealingPool& pool,
+                        ParticleStore& store, std::size_t count, float dt, const ContactSettings& settings) {
+    solveContacts(solver, pool, store.posX.data(), store.posY.data(), count, 2.0f * scene.radius, dt, settings,
+                  [&] { projectBoundary(scene.boundary, store, scene.radius, count); });
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+// Pieces for running the simulation and rendering on separate threads. The
+// simulation thread publishes each new state through a triple buffer while the
+// render thread draws the newest complete one, so a frame costs
+// max(step, draw) rather than step + draw. Window input goes the other way,
+// from the GLFW callbacks on the render thread over a single-producer,
+// single-consumer queue. Both are lock-free: the only shared words are atomics.
+
+#include <atomic>
+#include <cstddef>
+#include <thread>
+
+// Three slots: the producer owns `back`, the consumer owns `front`, and the
+// third is parked in `middle`. Publishing swaps back with middle and acquiring
+// swaps front with middle, each in one atomic exchange, so neither side ever
+// waits. Frames the consumer has not picked up are replaced by newer ones.
+const int TRIPLE_FRESH = 4; // set in `middle` while it holds an unread frame
+
+template <typename T>
+struct TripleBuffer {
+    T slots[3];
+    std::atomic<int> middle{1};
+    int back = 0;
+    int front = 2;
+};
+
+template <typename T>
+T& backSlot(TripleBuffer<T>& buffer) {
+    return buffer.slots[buffer.back];
+}
+
+template <typename T>
+void publish(TripleBuffer<T>& buffer) {
+    buffer.back = buffer.middle.exchange(buffer.back | TRIPLE_FRESH, std::memory_order_acq_rel) & 3;
+}
+
+// Moves the newest published frame to the front; false if nothing new arrived.
+template <typename T>
+bool acquire(TripleBuffer<T>& buffer) {
+    if (!(buffer.middle.load(std::memory_order_relaxed) & TRIPLE_FRESH)) return false;
+    buffer.front = buffer.middle.exchange(buffer.front, std::memory_order_acq_rel) & 3;
+    return true;
+}
+
+template <typename T>
+T& frontSlot(TripleBuffer<T>& buffer) {
+    return buffer.slots[buffer.front];
+}
+
+// Bounded ring of `Capacity` items (a power of two). The indices only grow; the
+// producer writes `tail` and the consumer writes `head`, each on its own cache line.
+template <typename T, std::size_t Capacity>
+struct SpscQueue {
+    static_assert((Capacity & (Capacity - 1)) == 0, "capacity must be a power of two");
+    T items[Capacity];
+    alignas(64) std::atomic<std::size_t> head{0};
+    alignas(64) std::atomic<std::size_t> tail{0};
+};
+
+template <typename T, std::size_t Capacity>
+bool tryPush(SpscQueue<T, Capacity>& queue, const T& item) {
+    std::size_t tail = queue.tail.load(std::memory_order_relaxed);
+    if (tail - queue.head.load(std::memory_order_acquire) == Capacity) return false;
+    queue.items[tail & (Capacity - 1)] = item;
+    queue.tail.store(tail + 1, std::memory_order_release);
+    return true;
+}
+
+// Input must not be dropped (a lost release leaves a button held), so a full
+// queue waits for the consumer.
+template <typename T, std::size_t Capacity>
+void push(SpscQueue<T, Capacity>& queue, const T& item) {
+    while (!tryPush(queue, item)) std::this_thread::yield();
+}
+
+template <typename T, std::size_t Capacity>
+bool pop(SpscQueue<T, Capacity>& queue, T& item) {
+    std::size_t head = queue.head.load(std::memory_order_relaxed);
+    if (head == queue.tail.load(std::memory_order_acquire)) return false;
+    item = queue.items[head & (Capacity - 1)];
+    queue.head.store(head + 1, std::memory_order_release);
+    return true;
+}
+
+// Pointer and primary-action changes from the window callbacks.
+struct InputMessage {
+    bool moved = false;
+    float x = 0.0f, y = 0.0f; // world coordinates, when moved
+    int action = -1;          // 1 pressed, 0 released, -1 unchanged
+};
@@ -0,0 +1,360 @@
+#pragma once
+
+// Scoped phase timers for finding where frame time goes. A ProfileScope
+// records its phase's start and duration into a ring buffer owned by the
+// calling thread, so recording takes no lock and threads never write to the
+// same memory; with profiling off a scope costs one relaxed load and a branch.
+// Counters (particle count, pair tests, ...) go into the same buffers.
+//
+// Once a frame the render thread drains the new events into rolling per-phase
+// statistics, which the overlay draws as each phase's p50 and p99 time per
+// frame next to the latest counter values. The events still held in the
+// buffers can be written as Chrome trace-event JSON, for chrome://tracing or
+// Perfetto.
+//
+//   ./particles2 --profile                 overlay in the window
+//   ./particles2 --trace frames.json       trace written at exit (also with --bench)
+
+#include <GL/glew.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+const std::size_t PROFILE_EVENTS = 1 << 15; // per thread; the oldest are overwritten
+const int PROFILE_WINDOW = 240;             // frames the overlay's percentiles cover
+
+using ProfileClock = std::chrono::steady_clock;
+
+struct ProfileEvent {
+    const char* name = nullptr; // a string literal; phases are told apart by name
+    int64_t start = 0;          // ns since the profiler started
+    int64_t value = 0;          // duration in ns, or the counter's value
+    bool counter = false;
+};
+
+// A ring buffer slot, read while its thread may be rewriting it. It works as a
+// seqlock: `sequence` is n + 1 once event n is complete and 0 while an event is
+// being written, and the fields are relaxed atomics so a racing read is a stale
+// or mixed copy rather than undefined behaviour, which the sequence then rejects.
+struct ProfileSlot {
+    std::atomic<uint64_t> sequence{0};
+    std::atomic<const char*> name{nullptr};
+    std::atomic<int64_t> start{0};
+    std::atomic<int64_t> value{0};
+    std::atomic<bool> counter{false};
+};
+
+struct ProfileBuffer {
+    ProfileSlot events[PROFILE_EVENTS];
+    std::atomic<uint64_t> written{0}; // events ever recorded
+    uint64_t drained = 0;             // events the overlay has seen; render thread only
+    int thread = 0;
+};
+
+struct Profiler {
+    std::atomic<bool> enabled{false};
+    ProfileClock::time_point epoch = ProfileClock::now();
+    std::mutex mutex; // guards `buffers`, which only grows
+    std::vector<std::unique_ptr<ProfileBuffer>> buffers;
+};
+
+inline Profiler& profiler() {
+    static Profiler instance;
+    return instance;
+}
+
+inline bool profiling() {
+    return profiler().enabled.load(std::memory_order_relaxed);
+}
+
+inline int64_t profileNow() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(ProfileClock::now() - profiler().epoch).count();
+}
+
+// The calling thread's buffer, registered on its first event. Buffers outlive
+// their threads so a trace still has their events.
+inline ProfileBuffer& threadProfileBuffer() {
+    thread_local ProfileBuffer* buffer = nullptr;
+    if (!buffer) {
+        Profiler& p = profiler();
+        std::lock_guard<std::mutex> lock(p.mutex);
+        p.buffers.push_back(std::unique_ptr<ProfileBuffer>(new ProfileBuffer()));
+        buffer = p.buffers.back().get();
+        buffer->thread = static_cast<int>(p.buffers.size());
+    }
+    return *buffer;
+}
+
+inline void recordProfileEvent(const char* name, int64_t start, int64_t value, bool counter) {
+    ProfileBuffer& buffer = threadProfileBuffer();
+    uint64_t n = buffer.written.load(std::memory_order_relaxed);
+    ProfileSlot& slot = buffer.events[n & (PROFILE_EVENTS - 1)];
+    // The fence keeps the fields' stores from becoming visible before the slot
+    // is marked as being written.
+    slot.sequence.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.name.store(name, std::memory_order_relaxed);
+    slot.start.store(start, std::memory_order_relaxed);
+    slot.value.store(value, std::memory_order_relaxed);
+    slot.counter.store(counter, std::memory_order_relaxed);
+    slot.sequence.store(n + 1, std::memory_order_release);
+    buffer.written.store(n + 1, std::memory_order_release);
+}
+
+// Times the enclosing block as `phase`, which must be a string literal.
+struct ProfileScope {
+    const char* name;
+    int64_t start = 0;
+
+    explicit ProfileScope(const char* phase) : name(profiling() ? phase : nullptr) {
+        if (name) start = profileNow();
+    }
+    ~ProfileScope() {
+        if (name) recordProfileEvent(name, start, profileNow() - start, false);
+    }
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+};
+
+inline void profileCounter(const char* name, int64_t value) {
+    if (profiling()) recordProfileEvent(name, profileNow(), value, true);
+}
+
+// Rolling statistics for the overlay, in the order phases first appeared.
+struct PhaseStats {
+    const char* name = nullptr;
+    bool counter = false;
+    float samples[PROFILE_WINDOW] = {}; // ms spent in the phase per frame
+    int64_t frameTotal = 0;             // ns so far this frame
+    int64_t value = 0;                  // latest, for counters
+};
+
+struct ProfileOverlay {
+    std::vector<PhaseStats> phases;
+    int frames = 0; // samples filled, up to PROFILE_WINDOW
+    int next = 0;
+};
+
+inline PhaseStats& phaseStats(ProfileOverlay& overlay, const char* name, bool counter) {
+    for (PhaseStats& stats : overlay.phases) {
+        if (stats.name == name || std::strcmp(stats.name, name) == 0) return stats;
+    }
+    overlay.phases.emplace_back();
+    overlay.phases.back().name = name;
+    overlay.phases.back().counter = counter;
+    return overlay.phases.back();
+}
+
+// Copies event n out of `buffer`, which its thread may still be recording
+// into. Returns false unless the slot held event n, complete, both before and
+// after the copy; otherwise the writer has moved on to the event that reuses
+// n's slot and the copy may be torn.
+inline bool readProfileEvent(const ProfileBuffer& buffer, uint64_t n, ProfileEvent& event) {
+    const ProfileSlot& slot = buffer.events[n & (PROFILE_EVENTS - 1)];
+    if (slot.sequence.load(std::memory_order_acquire) != n + 1) return false;
+    event.name = slot.name.load(std::memory_order_relaxed);
+    event.start = slot.start.load(std::memory_order_relaxed);
+    event.value = slot.value.load(std::memory_order_relaxed);
+    event.counter = slot.counter.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return slot.sequence.load(std::memory_order_relaxed) == n + 1;
+}
+
+// Moves the events recorded since the last call into the statistics as one
+// frame. Events a writer has already overwritten, or is overwriting, are skipped.
+inline void collectProfile(ProfileOverlay& overlay) {
+    Profiler& p = profiler();
+    {
+        std::lock_guard<std::mutex> lock(p.mutex);
+        for (auto& buffer : p.buffers) {
+            uint64_t written = buffer->written.load(std::memory_order_acquire);
+            uint64_t first = std::max(buffer->drained, written > PROFILE_EVENTS ? written - PROFILE_EVENTS : 0);
+            for (uint64_t n = first; n < written; ++n) {
+                ProfileEvent event;
+                if (!readProfileEvent(*buffer, n, event)) continue;
+                PhaseStats& stats = phaseStats(overlay, event.name, event.counter);
+                if (event.counter) stats.value = event.value;
+                else stats.frameTotal += event.value;
+            }
+            buffer->drained = written;
+        }
+    }
+    for (PhaseStats& stats : overlay.phases) {
+        stats.samples[overlay.next] = static_cast<float>(stats.frameTotal * 1e-6);
+        stats.frameTotal = 0;
+    }
+    overlay.next = (overlay.next + 1) % PROFILE_WINDOW;
+    overlay.frames = std::min(overlay.frames + 1, PROFILE_WINDOW);
+}
+
+inline float phasePercentile(const PhaseStats& stats, int frames, float fraction) {
+    if (frames == 0) return 0.0f;
+    float sorted[PROFILE_WINDOW];
+    std::copy(stats.samples, stats.samples + frames, sorted);
+    int k = std::min(frames - 1, static_cast<int>(fraction * frames));
+    std::nth_element(sorted, sorted + k, sorted + frames);
+    return sorted[k];
+}
+
+// 3x5 pixel glyphs, rows top to bottom, for the characters the overlay uses.
+inline const char* overlayGlyph(char c) {
+    static const struct { char c; const char* rows; } glyphs[] = {
+        { '0', "111101101101111" }, { '1', "010110010010111" }, { '2', "111001111100111" },
+        { '3', "111001111001111" }, { '4', "101101111001001" }, { '5', "111100111001111" },
+        { '6', "111100111101111" }, { '7', "111001001001001" }, { '8', "111101111101111" },
+        { '9', "111101111001111" }, { 'A', "010101111101101" }, { 'B', "110101110101110" },
+        { 'C', "011100100100011" }, { 'D', "110101101101110" }, { 'E', "111100110100111" },
+        { 'F', "111100110100100" }, { 'G', "011100101101011" }, { 'H', "101101111101101" },
+        { 'I', "111010010010111" }, { 'J', "001001001101010" }, { 'K', "101101110101101" },
+        { 'L', "100100100100111" }, { 'M', "101111111101101" }, { 'N', "110101101101101" },
+        { 'O', "010101101101010" }, { 'P', "110101110100100" }, { 'Q', "010101101110011" },
+        { 'R', "110101110101101" }, { 'S', "011100010001110" }, { 'T', "111010010010010" },
+        { 'U', "101101101101111" }, { 'V', "101101101101010" }, { 'W', "101101111111101" },
+        { 'X', "101101010101101" }, { 'Y', "101101010010010" }, { 'Z', "111001010100111" },
+        { '.', "000000000000010" }, { ':', "000010000010000" }, { '/', "001001010100100" },
+        { '-', "000000111000000" }, { '%', "101001010100101" }, { '_', "000000000000111" },
+    };
+    if (c >= 'a' && c <= 'z') c = static_cast<char>(c - 'a' + 'A');
+    for (const auto& glyph : glyphs) {
+        if (glyph.c == c) return glyph.rows;
+    }
+    return nullptr; // drawn as a space
+}
+
+// Draws `text` with its top-left at (x, y) in pixels, `scale` pixels per dot.
+inline void drawOverlayText(float x, float y, const char* text, float scale) {
+    glBegin(GL_QUADS);
+    for (; *text; ++text, x += 4 * scale) {
+        const char* rows = overlayGlyph(*text);
+        if (!rows) continue;
+        for (int dot = 0; dot < 15; ++dot) {
+            if (rows[dot] != '1') continue;
+            float left = x + (dot % 3) * scale;
+            float top = y + (dot / 3) * scale;
+            glVertex2f(left, top);
+            glVertex2f(left + scale, top);
+            glVertex2f(left + scale, top + scale);
+            glVertex2f(left, top + scale);
+        }
+    }
+    glEnd();
+}
+
+// Draws the statistics in the top-left corner of the viewport, leaving the
+// projection and colour as they were.
+inline void drawProfileOverlay(const ProfileOverlay& overlay) {
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    glMatrixMode(GL_PROJECTION);
+    glPushMatrix();
+    glLoadIdentity();
+    glOrtho(0, viewport[2], viewport[3], 0, -1, 1);
+    glMatrixMode(GL_MODELVIEW);
+    glPushMatrix();
+    glLoadIdentity();
+    glPushAttrib(GL_CURRENT_BIT | GL_ENABLE_BIT | GL_COLOR_BUFFER_BIT);
+    glDisable(GL_TEXTURE_2D);
+
+    const float scale = 2.0f;
+    const float lineHeight = 7 * scale;
+    const float margin = 4 * scale;
+    char line[64];
+    float height = lineHeight * (overlay.phases.size() + 1) + 2 * margin;
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glColor4f(0.0f, 0.0f, 0.0f, 0.7f);
+    glRecti(0, 0, static_cast<GLint>(4 * scale * 30 + 2 * margin), static_cast<GLint>(height));
+    glDisable(GL_BLEND);
+
+    float y = margin;
+    glColor3f(1.0f, 1.0f, 0.4f);
+    drawOverlayText(margin, y, "PHASE          P50MS   P99MS", scale);
+    glColor3f(1.0f, 1.0f, 1.0f);
+    for (const PhaseStats& stats : overlay.phases) {
+        y += lineHeight;
+        if (stats.counter) {
+            std::snprintf(line, sizeof(line), "%-14.14s %7lld", stats.name, static_cast<long long>(stats.value));
+        } else {
+            std::snprintf(line, sizeof(line), "%-14.14s %7.2f %7.2f", stats.name,
+                          phasePercentile(stats, overlay.frames, 0.5f),
+                          phasePercentile(stats, overlay.frames, 0.99f));
+        }
+        drawOverlayText(margin, y, line, scale);
+    }
+
+    glPopAttrib();
+    glPopMatrix();
+    glMatrixMode(GL_PROJECTION);
+    glPopMatrix();
+    glMatrixMode(GL_MODELVIEW);
+}
+
+// Writes the events still held in every thread's buffer as Chrome trace-event
+// JSON: phases as complete ("X") events, counters as "C" events, times in µs.
+inline bool writeChromeTrace(const char* path) {
+    std::FILE* file = std::fopen(path, "wb");
+    if (!file) {
+        std::cerr << "Cannot write trace " << path << std::endl;
+        return false;
+    }
+    std::fputs("{\"traceEvents\":[", file);
+    bool first = true;
+    Profiler& p = profiler();
+    std::lock_guard<std::mutex> lock(p.mutex);
+    for (auto& buffer : p.buffers) {
+        uint64_t written = buffer->written.load(std::memory_order_acquire);
+        uint64_t begin = written > PROFILE_EVENTS ? written - PROFILE_EVENTS : 0;
+        for (uint64_t n = begin; n < written; ++n) {
+            ProfileEvent event;
+            if (!readProfileEvent(*buffer, n, event)) continue;
+            std::fputs(first ? "\n" : ",\n", file);
+            first = false;
+            if (event.counter) {
+                std::fprintf(file, "{\"name\":\"%s\",\"ph\":\"C\",\"ts\":%.3f,\"pid\":1,\"tid\":%d,\"args\":{\"value\":%lld}}",
+                             event.name, event.start * 1e-3, buffer->thread, static_cast<long long>(event.value));
+            } else {
+                std::fprintf(file, "{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%d}",
+                             event.name, event.start * 1e-3, event.value * 1e-3, buffer->thread);
+            }
+        }
+    }
+    std::fputs("\n]}\n", file);
+    bool ok = !std::ferror(file);
+    ok = std::fclose(file) == 0 && ok;
+    if (!ok) std::cerr << "Failed writing trace " << path << std::endl;
+    return ok;
+}
+
+struct ProfileOptions {
+    bool overlay = false;
+    const char* tracePath = nullptr;
+};
+
+// Consumes argv[i] (and its value) if it is a profiling option.
+inline bool parseProfileOption(int& i, int argc, char** argv, ProfileOptions& options) {
+    if (std::strcmp(argv[i], "--profile") == 0) {
+        options.overlay = true;
+    } else if (std::strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+        options.tracePath = argv[++i];
+    } else {
+        return false;
+    }
+    return true;
+}
+
+inline void startProfiling(const ProfileOptions& options) {
+    profiler().enabled.store(options.overlay || options.tracePath, std::memory_order_relaxed);
+}
+
+// Stops recording and writes the trace, if one was asked for.
+inline bool finishProfiling(const ProfileOptions& options) {
+    profiler().enabled.store(false, std::memory_order_relaxed);
+    return !options.tracePath || writeChromeTrace(options.tracePath);
+}
@@ -0,0 +1,269 @@
+#pragma once
+
+// Versioned binary snapshots with an optional recorded input stream, for
+// reproducing a run exactly. A file is a fixed header followed by sections,
+// each starting on a 64-byte boundary, so state arrays can be used or block
+// copied straight out of a read-only memory mapping with no parsing:
+//
+//   SnapshotHeader | pad | section 0 | pad | section 1 | ... | input events
+//
+// Particle snapshots store posX, posY, lastPosX, lastPosY, velX, velY in
+// sections 0-5 and spawn times in section 6. Life snapshots store the board
+// one bit per cell (BitBoard words) in section 0, the rule's name in section 1
+// and, for Generations rules, one state byte per cell in section 2. Recorded
+// input always lives in SNAPSHOT_INPUT_SECTION. Integers and floats are stored
+// in native byte order.
+//
+// Version 1 files may lack the spawn times and the rule, and still load: their
+// particles count as spawned at 0 and their boards as B3/S23. From version 2
+// both are required.
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <vector>
+#include "particle_store.h"
+
+const char SNAPSHOT_MAGIC[8] = { 'S', 'I', 'M', 'S', 'N', 'A', 'P', '\0' };
+const uint32_t SNAPSHOT_VERSION = 2;
+const uint32_t SNAPSHOT_OLDEST_VERSION = 1; // the oldest version still loaded
+const uint32_t SNAPSHOT_PARTICLES = 1;
+const uint32_t SNAPSHOT_LIFE = 2;
+const int SNAPSHOT_SECTIONS = 8;
+const int SNAPSHOT_INPUT_SECTION = SNAPSHOT_SECTIONS - 1;
+const uint64_t SNAPSHOT_ALIGNMENT = 64;
+
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t version = SNAPSHOT_VERSION;
+    uint32_t kind = 0;
+    uint64_t count = 0;     // particles, or board width for Life
+    uint64_t height = 0;    // board height for Life
+    uint64_t step = 0;      // physics ticks or generations already run
+    double time = 0.0;      // simulated seconds already run
+    double spawnTime = 0.0; // simulated time of the last particle spawn
+    float tickDt = 0.0f;    // fixed-step settings the input was recorded with
+    uint32_t substeps = 0;
+    uint64_t sectionOffset[SNAPSHOT_SECTIONS] = {};
+    uint64_t sectionBytes[SNAPSHOT_SECTIONS] = {};
+};
+
+// Input state from `step` onwards: the pointer position and whether the
+// program's primary action (mouse button or space) is held. Life records one
+// event per edited cell, with x and y holding the cell.
+struct InputEvent {
+    uint64_t step = 0;
+    float x = 0.0f;
+    float y = 0.0f;
+    uint32_t buttons = 0;
+    uint32_t reserved = 0;
+};
+
+struct SnapshotSection {
+    const void* data = nullptr;
+    uint64_t bytes = 0;
+};
+
+inline bool writeSnapshot(const char* path, SnapshotHeader header, const SnapshotSection (&sections)[SNAPSHOT_SECTIONS]) {
+    std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = SNAPSHOT_VERSION;
+    uint64_t offset = sizeof(SnapshotHeader);
+    for (int s = 0; s < SNAPSHOT_SECTIONS; ++s) {
+        offset = (offset + SNAPSHOT_ALIGNMENT - 1) / SNAPSHOT_ALIGNMENT * SNAPSHOT_ALIGNMENT;
+        header.sectionOffset[s] = offset;
+        header.sectionBytes[s] = sections[s].bytes;
+        offset += sections[s].bytes;
+    }
+
+    std::FILE* file = std::fopen(path, "wb");
+    if (!file) {
+        std::cerr << "Cannot write snapshot " << path << "\n";
+        return false;
+    }
+    static const char padding[SNAPSHOT_ALIGNMENT] = {};
+    bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1;
+    uint64_t written = sizeof(header);
+    for (int s = 0; s < SNAPSHOT_SECTIONS && ok; ++s) {
+        uint64_t gap = header.sectionOffset[s] - written;
+        ok = std::fwrite(padding, 1, gap, file) == gap;
+        if (ok && sections[s].bytes > 0) {
+            ok = std::fwrite(sections[s].data, 1, sections[s].bytes, file) == sections[s].bytes;
+        }
+        written = header.sectionOffset[s] + sections[s].bytes;
+    }
+    ok = std::fclose(file) == 0 && ok;
+    if (!ok) std::cerr << "Failed writing snapshot " << path << "\n";
+    return ok;
+}
+
+struct MappedSnapshot {
+    void* base = nullptr;
+    size_t size = 0;
+    const SnapshotHeader* header = nullptr;
+};
+
+inline void unmapSnapshot(MappedSnapshot& snapshot) {
+    if (snapshot.base) munmap(snapshot.base, snapshot.size);
+    snapshot = MappedSnapshot();
+}
+
+// Maps the file read-only and checks the header and section bounds. The
+// mapping stays valid until unmapSnapshot.
+inline bool mapSnapshot(const char* path, uint32_t kind, MappedSnapshot& snapshot) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "Cannot open snapshot " << path << "\n";
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(SnapshotHeader)) {
+        std::cerr << "Snapshot " << path << " is truncated\n";
+        close(fd);
+        return false;
+    }
+    void* base = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        std::cerr << "Cannot map snapshot " << path << "\n";
+        return false;
+    }
+    snapshot.base = base;
+    snapshot.size = info.st_size;
+    snapshot.header = static_cast<const SnapshotHeader*>(base);
+
+    const SnapshotHeader& header = *snapshot.header;
+    const char* problem = nullptr;
+    if (std::memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) != 0) {
+        problem = "is not a snapshot";
+    } else if (header.version < SNAPSHOT_OLDEST_VERSION || header.version > SNAPSHOT_VERSION) {
+        problem = "has an unsupported version";
+    } else if (header.kind != kind) {
+        problem = "is for a different simulation";
+    } else if (kind == SNAPSHOT_PARTICLES && !(std::isfinite(header.tickDt) && header.tickDt > 0.0f)) {
+        // Loading sets the fixed-step rate from it.
+        problem = "has an invalid tick length";
+    } else {
+        for (int s = 0; s < SNAPSHOT_SECTIONS; ++s) {
+            if (header.sectionOffset[s] % SNAPSHOT_ALIGNMENT != 0 ||
+                header.sectionOffset[s] > snapshot.size ||
+                header.sectionBytes[s] > snapshot.size - header.sectionOffset[s]) {
+                problem = "has a section outside the file";
+            }
+        }
+    }
+    if (problem) {
+        std::cerr << "Snapshot " << path << " " << problem << "\n";
+        unmapSnapshot(snapshot);
+        return false;
+    }
+    madvise(base, snapshot.size, MADV_SEQUENTIAL);
+    return true;
+}
+
+template <typename T>
+const T* snapshotSection(const MappedSnapshot& snapshot, int section) {
+    return reinterpret_cast<const T*>(static_cast<const char*>(snapshot.base) + snapshot.header->sectionOffset[section]);
+}
+
+template <typename T>
+size_t snapshotCount(const MappedSnapshot& snapshot, int section) {
+    return snapshot.header->sectionBytes[section] / sizeof(T);
+}
+
+// Records input as it changes, one event per change. A recorder of one-off
+// actions rather than held state (Life's cell edits) turns off changesOnly, so
+// repeating the last action is recorded too.
+struct InputRecorder {
+    bool enabled = false;
+    bool changesOnly = true;
+    std::vector<InputEvent> events;
+};
+
+inline void recordInput(InputRecorder& recorder, uint64_t step, float x, float y, uint32_t buttons) {
+    if (!recorder.enabled) return;
+    if (recorder.changesOnly && !recorder.events.empty()) {
+        const InputEvent& last = recorder.events.back();
+        if (last.x == x && last.y == y && last.buttons == buttons) return;
+    }
+    InputEvent event;
+    event.step = step;
+    event.x = x;
+    event.y = y;
+    event.buttons = buttons;
+    recorder.events.push_back(event);
+}
+
+// Plays recorded events back from a mapped snapshot.
+struct InputReplay {
+    const InputEvent* events = nullptr;
+    size_t count = 0;
+    size_t next = 0;
+};
+
+inline bool replayActive(const InputReplay& replay) {
+    return replay.next < replay.count;
+}
+
+// Returns the next event due at or before `step`, if any; call until it
+// returns false to drain every event of a step.
+inline bool nextInput(InputReplay& replay, uint64_t step, InputEvent& event) {
+    if (replay.next >= replay.count || replay.events[replay.next].step > step) return false;
+    event = replay.events[replay.next++];
+    return true;
+}
+
+// Writes a particle store and the input recorded since it was captured.
+inline bool writeParticleSnapshot(const char* path, SnapshotHeader header, const ParticleStore& store,
+                                  const std::vector<InputEvent>& input) {
+    header.kind = SNAPSHOT_PARTICLES;
+    header.count = store.size();
+    const FloatArray* arrays[7] = { &store.posX, &store.posY, &store.lastPosX, &store.lastPosY,
+                                    &store.velX, &store.velY, &store.birth };
+    SnapshotSection sections[SNAPSHOT_SECTIONS];
+    for (int s = 0; s < 7; ++s) {
+        sections[s] = { arrays[s]->data(), arrays[s]->size() * sizeof(float) };
+    }
+    sections[SNAPSHOT_INPUT_SECTION] = { input.data(), input.size() * sizeof(InputEvent) };
+    return writeSnapshot(path, header, sections);
+}
+
+// The arrays are block copies straight out of the mapping; the store keeps its
+// own buffers so particles can still be spawned afterwards. Call
+// reserveParticles() once loaded. Version 1 files without spawn times load as
+// spawned at 0.
+inline bool loadParticleSnapshot(const MappedSnapshot& snapshot, ParticleStore& store) {
+    const size_t count = snapshot.header->count;
+    FloatArray* arrays[6] = { &store.posX, &store.posY, &store.lastPosX, &store.lastPosY, &store.velX, &store.velY };
+    for (int s = 0; s < 6; ++s) {
+        if (snapshotCount<float>(snapshot, s) != count) {
+            std::cerr << "Snapshot particle arrays do not match its particle count\n";
+            return false;
+        }
+    }
+    for (int s = 0; s < 6; ++s) {
+        const float* data = snapshotSection<float>(snapshot, s);
+        arrays[s]->assign(data, data + count);
+    }
+    store.birth.clear();
+    if (snapshotCount<float>(snapshot, 6) == count) {
+        const float* birth = snapshotSection<float>(snapshot, 6);
+        store.birth.assign(birth, birth + count);
+    } else if (snapshot.header->version >= 2) {
+        std::cerr << "Snapshot spawn times do not match its particle count\n";
+        return false;
+    }
+    return true;
+}
+
+inline InputReplay snapshotInput(const MappedSnapshot& snapshot) {
+    InputReplay replay;
+    replay.events = snapshotSection<InputEvent>(snapshot, SNAPSHOT_INPUT_SECTION);
+    replay.count = snapshotCount<InputEvent>(snapshot, SNAPSHOT_INPUT_SECTION);
+    return replay;
+}
@@ -3,6 +3,17 @@
 #include <iostream>
 #include <cmath>
 #include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <numeric>
+#include <random>
+#include <vector>
+#include "bench.h"
+#include "block_csr.h"
+#include "circle_renderer.h"
+#include "fixed_step.h"
+#include "frame_output.h"
+#include "particle_store.h"
 
 // Constants
 const float PI = 3.14159265358979323846f;
@@ -14,66 +25,419 @@ float damping = 0.1f;
 float restLengthX = 0.0f;
 float restLengthY = 0.0f;
 
+// Network parameters, used by the grid and cloth topologies
+float clothStiffness = 400.0f;
+float edgeDamping = 0.0f;   // dashpot along each spring
+float gravity = 0.0f;
+float nodeRadius = 0.05f;   // 0 draws springs only
+
 // Mouse interaction parameters
 bool isDragging = false;
 float mouseSpringConstant = 95.0f;
 double mouseX = 0.0f, mouseY = 0.0f;
+int pinnedNode = -1;        // node held by the mouse spring
+
+// Mass-spring network. Nodes reuse the particle storage of the particle
+// simulations; edges are parallel arrays sorted by node so that force
+// accumulation walks the node arrays almost sequentially.
+struct SpringNetwork {
+    ParticleStore nodes;
+    FloatArray forceX, forceY;
+    std::vector<float> invMass;  // 0 for fixed nodes
+    std::vector<int> edgeA, edgeB;
+    std::vector<float> restLength;
+    std::vector<float> stiffness;
+
+    size_t edgeCount() const { return edgeA.size(); }
+};
+
+SpringNetwork network;
+
+// Backward Euler solves (M - dt D - dt^2 K) dv = dt (f + dt K v) each step,
+// where K and D are the position and velocity Jacobians of the forces. It stays
+// stable at step sizes where the explicit update needs many substeps.
+enum class Integrator {
+    Explicit,
+    Implicit
+};
+
+Integrator integrator = Integrator::Explicit;
+float stiffnessOverride = 0.0f; // replaces the topology's spring stiffness when set
+const float cgTolerance = 1e-3f;
+const int cgMaxIterations = 200;
 
-// State variables
-float positionX = 0.0f;
-float positionY = 0.0f;
-float velocityX = 0.0f;
-float velocityY = 0.0f;
+// The sparsity pattern is fixed by the edges, so it is built once per topology
+// and each step only refills the blocks.
+struct ImplicitSystem {
+    BlockCsr matrix;
+    std::vector<int> diagonalBlock;        // per node
+    std::vector<int> edgeBlockAB, edgeBlockBA; // per edge
+    std::vector<float> rhs;
+    std::vector<float> deltaV;             // previous solution, the warm start
+    PcgWorkspace workspace;
+};
+
+ImplicitSystem implicitSystem;
+long long cgIterations = 0;
 
 void screenToWorld(GLFWwindow* window, double sx, double sy, double& wx, double& wy) {
     int width, height;
     glfwGetWindowSize(window, &width, &height);
-    wx = sx / width;  // Normalize x coordinate to range [0, 1]
-    wy = sy / height; // Normalize y coordinate to range [0, 1]
+    wx = (sx / width) * 2.0f - 1.0f;  // Normalize x coordinate to range [-1, 1]
+    wy = 1.0f - (sy / height) * 2.0f; // Normalize y coordinate to range [-1, 1]
 }
 
-float lastPositionX = positionX;
-float lastPositionY = positionY;
+CircleRenderer circles;
+FixedStep fixedStep;
+RenderPositions renderPositions;
+std::vector<float> lineVertices;
+FloatArray drawnX, drawnY;
 
-void updatePhysics(float dt) {
-    // Compute forces
-    float forceX = -k * (positionX - restLengthX) + (isDragging ? mouseSpringConstant * (mouseX - positionX) : 0.0f);
-    float forceY = -k * (positionY - restLengthY) + (isDragging ? mouseSpringConstant * (mouseY - positionY) : 0.0f);
+int addNode(SpringNetwork& net, float x, float y, float invMass) {
+    addParticle(net.nodes, x, y);
+    net.forceX.push_back(0.0f);
+    net.forceY.push_back(0.0f);
+    net.invMass.push_back(invMass);
+    return static_cast<int>(net.invMass.size()) - 1;
+}
+
+// The rest length is the current distance between the nodes.
+void addEdge(SpringNetwork& net, int a, int b, float stiffness) {
+    float dx = net.nodes.posX[b] - net.nodes.posX[a];
+    float dy = net.nodes.posY[b] - net.nodes.posY[a];
+    net.edgeA.push_back(std::min(a, b));
+    net.edgeB.push_back(std::max(a, b));
+    net.restLength.push_back(std::sqrt(dx * dx + dy * dy));
+    net.stiffness.push_back(stiffness);
+}
+
+void sortEdges(SpringNetwork& net) {
+    std::vector<int> order(net.edgeCount());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](int l, int r) {
+        if (net.edgeA[l] != net.edgeA[r]) return net.edgeA[l] < net.edgeA[r];
+        return net.edgeB[l] < net.edgeB[r];
+    });
+    auto permute = [&](auto& values) {
+        auto sorted = values;
+        for (size_t e = 0; e < order.size(); ++e) sorted[e] = values[order[e]];
+        values.swap(sorted);
+    };
+    permute(net.edgeA);
+    permute(net.edgeB);
+    permute(net.restLength);
+    permute(net.stiffness);
+}
+
+// The original single mass: a zero-length spring to a fixed anchor at the rest
+// position.
+void loadSingle(SpringNetwork& net) {
+    net = SpringNetwork();
+    reserveParticles(net.nodes, 2);
+    int anchor = addNode(net, restLengthX, restLengthY, 0.0f);
+    int ball = addNode(net, restLengthX, restLengthY, 1.0f / mass);
+    addEdge(net, anchor, ball, stiffnessOverride > 0.0f ? stiffnessOverride : k);
+    gravity = 0.0f;
+    edgeDamping = 0.0f;
+    nodeRadius = 0.05f;
+}
+
+// A size x size sheet of nodes, row-major so neighbouring nodes are close in
+// memory, with structural and shear springs. A cloth also gets bend springs
+// across every other node, hangs from its top row and feels gravity; a grid is
+// a free-floating soft body.
+void loadSheet(SpringNetwork& net, int size, bool cloth) {
+    net = SpringNetwork();
+    size = std::max(2, size);
+    reserveParticles(net.nodes, static_cast<size_t>(size) * size);
+    const float extent = 1.6f;
+    const float spacing = extent / (size - 1);
+    const float stiffness = stiffnessOverride > 0.0f ? stiffnessOverride : clothStiffness;
+    auto node = [&](int column, int row) { return row * size + column; };
+
+    for (int row = 0; row < size; ++row) {
+        for (int column = 0; column < size; ++column) {
+            bool fixed = cloth && row == 0;
+            addNode(net, -0.5f * extent + column * spacing, 0.8f - row * spacing, fixed ? 0.0f : 1.0f / mass);
+        }
+    }
+    for (int row = 0; row < size; ++row) {
+        for (int column = 0; column < size; ++column) {
+            int n = node(column, row);
+            if (column + 1 < size) addEdge(net, n, node(column + 1, row), stiffness);
+            if (row + 1 < size) addEdge(net, n, node(column, row + 1), stiffness);
+            if (column + 1 < size && row + 1 < size) {
+                addEdge(net, n, node(column + 1, row + 1), stiffness);
+                addEdge(net, node(column + 1, row), node(column, row + 1), stiffness);
+            }
+            if (cloth && column + 2 < size) addEdge(net, n, node(column + 2, row), stiffness);
+            if (cloth && row + 2 < size) addEdge(net, n, node(column, row + 2), stiffness);
+        }
+    }
+    sortEdges(net);
+    gravity = cloth ? 0.5f : 0.0f;
+    edgeDamping = 2.0f;
+    nodeRadius = 0.0f;
+}
+
+bool loadTopology(const char* name, int size) {
+    if (std::strcmp(name, "single") == 0) {
+        loadSingle(network);
+    } else if (std::strcmp(name, "grid") == 0) {
+        loadSheet(network, size, false);
+    } else if (std::strcmp(name, "cloth") == 0) {
+        loadSheet(network, size, true);
+    } else {
+        return false;
+    }
+    return true;
+}
+
+void buildImplicitSystem(ImplicitSystem& system, const SpringNetwork& net) {
+    const int nodeCount = static_cast<int>(net.nodes.size());
+    std::vector<std::vector<int>> neighbours(nodeCount);
+    for (int i = 0; i < nodeCount; ++i) neighbours[i].push_back(i);
+    for (size_t e = 0; e < net.edgeCount(); ++e) {
+        neighbours[net.edgeA[e]].push_back(net.edgeB[e]);
+        neighbours[net.edgeB[e]].push_back(net.edgeA[e]);
+    }
+
+    BlockCsr& matrix = system.matrix;
+    matrix.rows = nodeCount;
+    matrix.rowStart.assign(1, 0);
+    matrix.column.clear();
+    for (auto& row : neighbours) {
+        std::sort(row.begin(), row.end());
+        row.erase(std::unique(row.begin(), row.end()), row.end());
+        matrix.column.insert(matrix.column.end(), row.begin(), row.end());
+        matrix.rowStart.push_back(static_cast<int>(matrix.column.size()));
+    }
+    matrix.blocks.assign(4 * matrix.column.size(), 0.0f);
+
+    system.diagonalBlock.resize(nodeCount);
+    for (int i = 0; i < nodeCount; ++i) system.diagonalBlock[i] = findBlock(matrix, i, i);
+    system.edgeBlockAB.resize(net.edgeCount());
+    system.edgeBlockBA.resize(net.edgeCount());
+    for (size_t e = 0; e < net.edgeCount(); ++e) {
+        system.edgeBlockAB[e] = findBlock(matrix, net.edgeA[e], net.edgeB[e]);
+        system.edgeBlockBA[e] = findBlock(matrix, net.edgeB[e], net.edgeA[e]);
+    }
+    system.rhs.assign(2 * nodeCount, 0.0f);
+    system.deltaV.assign(2 * nodeCount, 0.0f);
+}
+
+// Closest movable node, for the mouse pin.
+int nearestNode(float x, float y) {
+    int best = -1;
+    float bestDistance = 0.0f;
+    for (size_t i = 0; i < network.nodes.size(); ++i) {
+        if (network.invMass[i] == 0.0f) continue;
+        float dx = network.nodes.posX[i] - x;
+        float dy = network.nodes.posY[i] - y;
+        float distance = dx * dx + dy * dy;
+        if (best < 0 || distance < bestDistance) {
+            best = static_cast<int>(i);
+            bestDistance = distance;
+        }
+    }
+    return best;
+}
+
+void accumulateForces() {
+    const ParticleStore& nodes = network.nodes;
+    const size_t count = nodes.size();
+
+    // Gravity and damping forces
+    for (size_t i = 0; i < count; ++i) {
+        float nodeMass = network.invMass[i] > 0.0f ? 1.0f / network.invMass[i] : 0.0f;
+        network.forceX[i] = -damping * nodes.velX[i];
+        network.forceY[i] = -damping * nodes.velY[i] - gravity * nodeMass;
+    }
+
+    // Spring forces, with a dashpot along the spring
+    for (size_t e = 0; e < network.edgeCount(); ++e) {
+        int a = network.edgeA[e];
+        int b = network.edgeB[e];
+        float dx = nodes.posX[b] - nodes.posX[a];
+        float dy = nodes.posY[b] - nodes.posY[a];
+        float length = std::sqrt(dx * dx + dy * dy);
+        if (length < 1e-6f) continue;
+        float nx = dx / length;
+        float ny = dy / length;
+        float closing = (nodes.velX[b] - nodes.velX[a]) * nx + (nodes.velY[b] - nodes.velY[a]) * ny;
+        float tension = network.stiffness[e] * (length - network.restLength[e]) + edgeDamping * closing;
+        network.forceX[a] += tension * nx;
+        network.forceY[a] += tension * ny;
+        network.forceX[b] -= tension * nx;
+        network.forceY[b] -= tension * ny;
+    }
+
+    // Mouse spring on the pinned node
+    if (isDragging && pinnedNode >= 0) {
+        network.forceX[pinnedNode] += mouseSpringConstant * (mouseX - nodes.posX[pinnedNode]);
+        network.forceY[pinnedNode] += mouseSpringConstant * (mouseY - nodes.posY[pinnedNode]);
+    }
+}
+
+void integrateExplicit(float dt) {
+    ParticleStore& nodes = network.nodes;
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        if (network.invMass[i] == 0.0f) continue;
+
+        // Calculate acceleration
+        float accelerationX = network.forceX[i] * network.invMass[i];
+        float accelerationY = network.forceY[i] * network.invMass[i];
 
-    // Damping forces
-    forceX -= damping * velocityX;
-    forceY -= damping * velocityY;
+        // Semi-implicit Euler integration for velocity
+        nodes.velX[i] += accelerationX * dt;
+        nodes.velY[i] += accelerationY * dt;
 
-    // Calculate acceleration
-    float accelerationX = forceX / mass;
-    float accelerationY = forceY / mass;
+        // Verlet integration for position
+        float tempPosX = nodes.posX[i];
+        float tempPosY = nodes.posY[i];
+        nodes.posX[i] = 2.0f * nodes.posX[i] - nodes.lastPosX[i] + accelerationX * dt * dt;
+        nodes.posY[i] = 2.0f * nodes.posY[i] - nodes.lastPosY[i] + accelerationY * dt * dt;
+        nodes.lastPosX[i] = tempPosX;
+        nodes.lastPosY[i] = tempPosY;
+    }
+}
+
+inline void addBlock(float* block, float scale, float xx, float xy, float yy) {
+    block[0] += scale * xx;
+    block[1] += scale * xy;
+    block[2] += scale * xy;
+    block[3] += scale * yy;
+}
+
+// Assembles the backward Euler system from the forces accumulated this step and
+// solves it for the velocity change. Fixed nodes keep an identity row and a zero
+// right-hand side, and their coupling blocks are left empty so the matrix stays
+// symmetric.
+void integrateImplicit(float dt) {
+    ParticleStore& nodes = network.nodes;
+    ImplicitSystem& system = implicitSystem;
+    BlockCsr& matrix = system.matrix;
+    const size_t count = nodes.size();
+    std::fill(matrix.blocks.begin(), matrix.blocks.end(), 0.0f);
+
+    for (size_t i = 0; i < count; ++i) {
+        float* block = &matrix.blocks[4 * system.diagonalBlock[i]];
+        bool fixed = network.invMass[i] == 0.0f;
+        float diagonal = fixed ? 1.0f : 1.0f / network.invMass[i] + dt * damping;
+        if (!fixed && isDragging && static_cast<int>(i) == pinnedNode) diagonal += dt * dt * mouseSpringConstant;
+        addBlock(block, 1.0f, diagonal, 0.0f, diagonal);
+        system.rhs[2 * i] = fixed ? 0.0f : dt * network.forceX[i];
+        system.rhs[2 * i + 1] = fixed ? 0.0f : dt * network.forceY[i];
+    }
+    if (isDragging && pinnedNode >= 0) {
+        system.rhs[2 * pinnedNode] -= dt * dt * mouseSpringConstant * nodes.velX[pinnedNode];
+        system.rhs[2 * pinnedNode + 1] -= dt * dt * mouseSpringConstant * nodes.velY[pinnedNode];
+    }
+
+    for (size_t e = 0; e < network.edgeCount(); ++e) {
+        int a = network.edgeA[e];
+        int b = network.edgeB[e];
+        float dx = nodes.posX[b] - nodes.posX[a];
+        float dy = nodes.posY[b] - nodes.posY[a];
+        float length = std::sqrt(dx * dx + dy * dy);
+        if (length < 1e-6f) {
+            // Zero-length spring: the Jacobian is just -k I
+            dx = 1.0f;
+            dy = 0.0f;
+            length = 1.0f;
+        }
+        float nx = dx / length;
+        float ny = dy / length;
+
+        // -dt D - dt^2 K for this spring. The transverse term is clamped at zero
+        // for compressed springs, which would otherwise make the matrix indefinite.
+        float stiffness = network.stiffness[e];
+        float transverse = std::max(0.0f, 1.0f - network.restLength[e] / length);
+        float along = dt * edgeDamping + dt * dt * stiffness;
+        float across = dt * dt * stiffness * transverse;
+        float xx = along * nx * nx + across * (1.0f - nx * nx);
+        float xy = along * nx * ny - across * nx * ny;
+        float yy = along * ny * ny + across * (1.0f - ny * ny);
 
-    // Semi-implicit Euler integration for velocity
-    velocityX += accelerationX * dt;
-    velocityY += accelerationY * dt;
+        bool fixedA = network.invMass[a] == 0.0f;
+        bool fixedB = network.invMass[b] == 0.0f;
+        if (!fixedA) addBlock(&matrix.blocks[4 * system.diagonalBlock[a]], 1.0f, xx, xy, yy);
+        if (!fixedB) addBlock(&matrix.blocks[4 * system.diagonalBlock[b]], 1.0f, xx, xy, yy);
+        if (!fixedA && !fixedB) {
+            addBlock(&matrix.blocks[4 * system.edgeBlockAB[e]], -1.0f, xx, xy, yy);
+            addBlock(&matrix.blocks[4 * system.edgeBlockBA[e]], -1.0f, xx, xy, yy);
+        }
 
-    // Verlet integration for position
-    float tempPosX = positionX;
-    float tempPosY = positionY;
-    positionX = 2.0f * positionX - lastPositionX + accelerationX * dt * dt;
-    positionY = 2.0f * positionY - lastPositionY + accelerationY * dt * dt;
-    lastPositionX = tempPosX;
-    lastPositionY = tempPosY;
+        // dt^2 K v, using only the stiffness part of the block
+        float kxx = dt * dt * stiffness * (nx * nx + transverse * (1.0f - nx * nx));
+        float kxy = dt * dt * stiffness * (nx * ny - transverse * nx * ny);
+        float kyy = dt * dt * stiffness * (ny * ny + transverse * (1.0f - ny * ny));
+        float relX = nodes.velX[b] - nodes.velX[a];
+        float relY = nodes.velY[b] - nodes.velY[a];
+        float pullX = kxx * relX + kxy * relY;
+        float pullY = kxy * relX + kyy * relY;
+        if (!fixedA) {
+            system.rhs[2 * a] += pullX;
+            system.rhs[2 * a + 1] += pullY;
+        }
+        if (!fixedB) {
+            system.rhs[2 * b] -= pullX;
+            system.rhs[2 * b + 1] -= pullY;
+        }
+    }
+
+    cgIterations += solvePcg(matrix, system.rhs, system.deltaV, cgTolerance, cgMaxIterations, system.workspace);
+
+    for (size_t i = 0; i < count; ++i) {
+        if (network.invMass[i] == 0.0f) continue;
+        nodes.velX[i] += system.deltaV[2 * i];
+        nodes.velY[i] += system.deltaV[2 * i + 1];
+        nodes.lastPosX[i] = nodes.posX[i];
+        nodes.lastPosY[i] = nodes.posY[i];
+        nodes.posX[i] += dt * nodes.velX[i];
+        nodes.posY[i] += dt * nodes.velY[i];
+    }
 }
 
+void updatePhysics(float dt) {
+    accumulateForces();
+    if (integrator == Integrator::Implicit) {
+        integrateImplicit(dt);
+    } else {
+        integrateExplicit(dt);
+    }
+}
+
+void render(float alpha) {
+    blendPositions(renderPositions, network.nodes, alpha);
+    const FloatArray& x = renderPositions.x;
+    const FloatArray& y = renderPositions.y;
 
-void render() {
     glClear(GL_COLOR_BUFFER_BIT);
-    glBegin(GL_POLYGON);
-    for (int i = 0; i < 360; i++) {
-        float degInRad = i * PI / 180;
-        glVertex2f(cos(degInRad) * 0.05f + positionX, sin(degInRad) * 0.05f + positionY);
+
+    lineVertices.resize(network.edgeCount() * 4);
+    for (size_t e = 0; e < network.edgeCount(); ++e) {
+        lineVertices[4 * e] = x[network.edgeA[e]];
+        lineVertices[4 * e + 1] = y[network.edgeA[e]];
+        lineVertices[4 * e + 2] = x[network.edgeB[e]];
+        lineVertices[4 * e + 3] = y[network.edgeB[e]];
+    }
+    glColor3f(1.0f, 1.0f, 1.0f);
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glVertexPointer(2, GL_FLOAT, 0, lineVertices.data());
+    glDrawArrays(GL_LINES, 0, static_cast<GLsizei>(network.edgeCount() * 2));
+    glDisableClientState(GL_VERTEX_ARRAY);
+
+    if (nodeRadius > 0.0f) {
+        drawnX.clear();
+        drawnY.clear();
+        for (size_t i = 0; i < network.nodes.size(); ++i) {
+            if (network.invMass[i] == 0.0f) continue;
+            drawnX.push_back(x[i]);
+            drawnY.push_back(y[i]);
+        }
+        drawCircles(circles, drawnX.data(), drawnY.data(), drawnX.size(), nodeRadius, 1.0f, 1.0f, 1.0f);
     }
-    glEnd();
-    glBegin(GL_LINES);
-    glVertex2f(restLengthX, restLengthY);
-    glVertex2f(positionX, positionY);
-    glEnd();
 }
 
 void mouse_button_callback(GLFWwindow* window, int button, int action, int mods) {
@@ -83,8 +447,10 @@ void mouse_button_callback(GLFWwindow* window, int button, int action, int mods)
         screenToWorld(window, xpos, ypos, mouseX, mouseY);
         if (action == GLFW_PRESS) {
             isDragging = true;
+            pinnedNode = nearestNode(static_cast<float>(mouseX), static_cast<float>(mouseY));
         } else if (action == GLFW_RELEASE) {
             isDragging = false;
+            pinnedNode = -1;
         }
     }
 }
@@ -102,12 +468,82 @@ void cursor_position_callback(GLFWwindow* window, double xpos, double ypos) {
     }
 }
 
-int main() {
+// Drags a seeded random node to a seeded random target every 100 steps,
+// releasing it for the second half of each interval.
+int runBenchmark(const BenchOptions& options) {
+    std::mt19937 rng(options.seed);
+    std::uniform_real_distribution<float> coord(-1.0f, 1.0f);
+
+    auto start = BenchClock::now();
+    for (int step = 0; step < options.steps; ++step) {
+        if (step % 100 == 0) {
+            mouseX = coord(rng);
+            mouseY = coord(rng);
+            pinnedNode = nearestNode(coord(rng), coord(rng));
+        }
+        isDragging = step % 100 < 50;
+        for (int substep = 0; substep < fixedStep.substeps; ++substep) {
+            updatePhysics(options.dt / fixedStep.substeps);
+        }
+    }
+    auto elapsed = BenchClock::now() - start;
+
+    double springs = static_cast<double>(network.edgeCount()) * options.steps * fixedStep.substeps;
+    printBenchReport("spring", options, elapsed, {
+        { "springs", springs },
+        { "cg_iterations", static_cast<double>(cgIterations) },
+    });
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    BenchOptions bench;
+    bench.dt = 0.01f;
+    bench.count = 1;
+    fixedStep.rate = 100.0f; // the old fixed 0.01 s per frame
+    const char* topology = "single";
+    int size = 32;
+    OutputOptions outputOptions;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--topology") == 0 && i + 1 < argc) {
+            topology = argv[++i];
+        } else if (std::strcmp(argv[i], "--size") == 0 && i + 1 < argc) {
+            size = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--stiffness") == 0 && i + 1 < argc) {
+            stiffnessOverride = static_cast<float>(std::atof(argv[++i]));
+        } else if (std::strcmp(argv[i], "--integrator") == 0 && i + 1 < argc) {
+            ++i;
+            if (std::strcmp(argv[i], "explicit") == 0) {
+                integrator = Integrator::Explicit;
+            } else if (std::strcmp(argv[i], "implicit") == 0) {
+                integrator = Integrator::Implicit;
+            } else {
+                std::cerr << "Unknown integrator: " << argv[i] << " (expected explicit or implicit)\n";
+                return -1;
+            }
+        } else if (!parseBenchOption(i, argc, argv, bench) && !parseFixedStepOption(i, argc, argv, fixedStep) &&
+                   !parseOutputOption(i, argc, argv, outputOptions)) {
+            std::cerr << "Unknown option: " << argv[i] << "\n";
+            return -1;
+        }
+    }
+    if (!loadTopology(topology, size)) {
+        std::cerr << "Unknown topology: " << topology << " (expected single, grid or cloth)\n";
+        return -1;
+    }
+    if (integrator == Integrator::Implicit) {
+        buildImplicitSystem(implicitSystem, network);
+    }
+    if (bench.enabled) {
+        return runBenchmark(bench);
+    }
+
     GLFWwindow* window;
     if (!glfwInit()) {
         std::cerr << "Failed to initialize GLFW\n";
         return -1;
     }
+    hideOutputWindow(outputOptions);
     window = glfwCreateWindow(640, 480, "Spring Mass Simulation", NULL, NULL);
     if (!window) {
         glfwTerminate();
@@ -117,18 +553,39 @@ int main() {
 
     glfwMakeContextCurrent(window);
     glewInit();
+    initCircleRenderer(circles);
+    FrameOutput frameOutput;
+    if (outputOptions.path) {
+        int width, height;
+        glfwGetFramebufferSize(window, &width, &height);
+        if (!beginFrameOutput(frameOutput, outputOptions, width, height)) return -1;
+        allowFrameTime(fixedStep, 1.0 / outputOptions.fps);
+    }
 
     glfwSetMouseButtonCallback(window, mouse_button_callback);
     glfwSetCursorPosCallback(window, cursor_position_callback);
 
     while (!glfwWindowShouldClose(window)) {
-        updatePhysics(0.01f);
-        render();
-        glfwSwapBuffers(window);
+        double now = outputOptions.path ? outputTime(outputOptions, frameOutput.submitted) : glfwGetTime();
+        int ticks = consumeTicks(fixedStep, now);
+        for (int tick = 0; tick < ticks; ++tick) {
+            savePositions(renderPositions, network.nodes);
+            for (int substep = 0; substep < fixedStep.substeps; ++substep) {
+                updatePhysics(substepDt(fixedStep));
+            }
+        }
+        render(interpolationAlpha(fixedStep));
+        if (outputOptions.path) {
+            submitFrame(frameOutput);
+            if (outputComplete(frameOutput, outputOptions)) break;
+        } else {
+            glfwSwapBuffers(window);
+        }
         glfwPollEvents();
     }
 
+    bool written = finishFrameOutput(frameOutput, outputOptions);
     glfwDestroyWindow(window);
     glfwTerminate();
-    return 0;
+    return written ? 0 : -1;
 }
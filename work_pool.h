@@ -0,0 +1,104 @@
+#pragma once
+
+// Persistent work-stealing thread pool. runTasks(pool, n, job) hands each
+// worker a contiguous slice of the task indices [0, n); a worker that finishes
+// its slice steals single tasks from the others until every slice is empty, so
+// uneven tasks (dense and sparse regions of a simulation) still keep all cores
+// busy. The calling thread works as worker 0, and runTasks returns once every
+// task has run.
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// One worker's slice. Owner and thieves both claim tasks by bumping `next`.
+struct alignas(64) TaskSlice {
+    std::atomic<int> next{0};
+    int end = 0;
+};
+
+struct StealingPool {
+    std::vector<std::thread> threads;
+    std::vector<TaskSlice> slices;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    std::function<void(int, int)> job; // runs (task, worker)
+    int workerCount = 1;
+    int epoch = 0;
+    int pending = 0;
+    bool stopping = false;
+};
+
+inline void drainTasks(StealingPool& pool, int worker) {
+    for (int offset = 0; offset < pool.workerCount; ++offset) {
+        TaskSlice& slice = pool.slices[(worker + offset) % pool.workerCount];
+        for (int task = slice.next.fetch_add(1); task < slice.end; task = slice.next.fetch_add(1)) {
+            pool.job(task, worker);
+        }
+    }
+}
+
+inline void stealingWorkerLoop(StealingPool& pool, int worker) {
+    int seenEpoch = 0;
+    while (true) {
+        std::unique_lock<std::mutex> lock(pool.mutex);
+        pool.wake.wait(lock, [&] { return pool.stopping || pool.epoch != seenEpoch; });
+        if (pool.stopping) return;
+        seenEpoch = pool.epoch;
+        lock.unlock();
+
+        drainTasks(pool, worker);
+
+        lock.lock();
+        if (--pool.pending == 0) pool.done.notify_one();
+    }
+}
+
+inline void startStealingPool(StealingPool& pool, int workerCount) {
+    pool.workerCount = std::max(1, workerCount);
+    pool.slices = std::vector<TaskSlice>(pool.workerCount);
+    for (int worker = 1; worker < pool.workerCount; ++worker) {
+        pool.threads.emplace_back(stealingWorkerLoop, std::ref(pool), worker);
+    }
+}
+
+inline void runTasks(StealingPool& pool, int taskCount, std::function<void(int, int)> job) {
+    if (taskCount <= 0) return;
+    if (pool.workerCount == 1) {
+        for (int task = 0; task < taskCount; ++task) job(task, 0);
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(pool.mutex);
+        pool.job = std::move(job);
+        for (int worker = 0; worker < pool.workerCount; ++worker) {
+            pool.slices[worker].next.store(taskCount * worker / pool.workerCount);
+            pool.slices[worker].end = taskCount * (worker + 1) / pool.workerCount;
+        }
+        pool.pending = pool.workerCount - 1;
+        pool.epoch++;
+    }
+    pool.wake.notify_all();
+
+    drainTasks(pool, 0);
+
+    std::unique_lock<std::mutex> lock(pool.mutex);
+    pool.done.wait(lock, [&] { return pool.pending == 0; });
+}
+
+inline void stopStealingPool(StealingPool& pool) {
+    {
+        std::lock_guard<std::mutex> lock(pool.mutex);
+        pool.stopping = true;
+    }
+    pool.wake.notify_all();
+    for (auto& thread : pool.threads) {
+        thread.join();
+    }
+    pool.threads.clear();
+}